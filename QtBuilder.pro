@@ -15,6 +15,21 @@ SOURCES += main.cpp \
 	qtcompile.cpp \
 	processes.cpp \
 	methods.cpp \
+	copyengine.cpp \
+	copybackend.cpp \
+	manifest.cpp \
+	filters.cpp \
+	trashbin.cpp \
+	scratch.cpp \
+	options.cpp \
+	envcache.cpp \
+	confcache.cpp \
+	objcache.cpp \
+	gencache.cpp \
+	outring.cpp \
+	eventbus.cpp \
+	logwriter.cpp \
+	logframes.cpp \
 	helpers.cpp \
 	guimain.cpp \
 	guilogs.cpp \
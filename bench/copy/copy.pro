@@ -0,0 +1,45 @@
+TARGET	 = copybench
+TEMPLATE = app
+QT      += core gui
+
+CONFIG	+= console
+CONFIG	-= app_bundle
+
+INCLUDEPATH += ../..
+
+# the copy engine works on a QtCompile, thus the app sources are linked (without its main)
+SOURCES += main.cpp \
+	../../qtbuilder.cpp \
+	../../qtcompile.cpp \
+	../../processes.cpp \
+	../../methods.cpp \
+	../../copyengine.cpp \
+	../../copybackend.cpp \
+	../../manifest.cpp \
+	../../filters.cpp \
+	../../trashbin.cpp \
+	../../scratch.cpp \
+	../../options.cpp \
+	../../envcache.cpp \
+	../../confcache.cpp \
+	../../objcache.cpp \
+	../../gencache.cpp \
+	../../outring.cpp \
+	../../eventbus.cpp \
+	../../logwriter.cpp \
+	../../logframes.cpp \
+	../../helpers.cpp \
+	../../guimain.cpp \
+	../../guilogs.cpp \
+	../../guitools.cpp \
+	../../guislider.cpp \
+	../../guiprogress.cpp
+
+HEADERS += \
+	../../qtbuilder.h \
+	../../definitions.h \
+	../../helpers.h \
+	../../appinfo.h
+
+RESOURCES += \
+	../../resources.qrc
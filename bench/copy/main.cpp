@@ -0,0 +1,134 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+//
+// stand-alone benchmark of the copy engine (see copyengine.cpp): the same synthetic tree is
+// copied with the default number of workers and with a single one (i.e. the serial copying
+// as before); mostly small files like a Qt source tree, plus a few large ones to be chunked.
+//
+// usage: copybench [folder] [files] [large files]
+//
+const int  qtBenchFiles	 = 20000;
+const int  qtBenchLarge	 = 4;
+const int  qtBenchPerDir = 40;
+const qint64 qtBenchLargeSize = 96*1024*1024;
+
+const QString benchFolder(const QString &root, int index)
+{
+	return QString("%1/src/d%2/s%3").arg(root).arg(index/(qtBenchPerDir*10)).arg(index/qtBenchPerDir);
+}
+
+qint64 createTree(const QString &root, int files, int large)
+{
+	qsrand(4711); // ... the same tree on every run.
+
+	qint64 total = 0;
+	QByteArray data;
+	for(int i = 0; i < files+large; i++)
+	{
+		QString dir = benchFolder(root, i);
+		if (!QDir(dir).exists() && !QDir().mkpath(dir))
+			return -1;
+
+		qint64 size = i < files ? 512+qrand()%(64*1024) : qtBenchLargeSize;
+		data.fill(char('a'+i%26), (int)qMin(size, (qint64)MBYTE));
+
+		QFile file(QString("%1/f%2.cpp").arg(dir).arg(i));
+		if (!file.open(QIODevice::WriteOnly))
+			return -1;
+		for(qint64 left = size; left > 0; left -= data.size())
+			file.write(data.constData(), qMin(left, (qint64)data.size()));
+		total += size;
+	}
+	return total;
+}
+
+bool removeTree(const QString &path)
+{
+	QFileInfoList infos = QDir(path).entryInfoList(QDir::NoDotAndDotDot|QDir::Hidden|QDir::AllDirs|QDir::Files);
+	FOR_CONST_IT(infos)
+		if ((*IT).isDir() && !(*IT).isSymLink())
+			 removeTree((*IT).absoluteFilePath());
+		else QFile::remove((*IT).absoluteFilePath());
+	return QDir().rmdir(path);
+}
+
+qint64 copyTree(QtCompile *compile, const QString &source, const QString &target, int threads, int &count, QString &summary)
+{
+	removeTree(target);
+	QDir().mkpath(target);
+
+	QElapsedTimer t;
+	t.start();
+
+	CopyEngine engine(compile, false, false, NULL, threads);
+	count = engine.run(-1, source, target, 0);
+	summary = engine.summary();
+	return t.elapsed();
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QStringList args = a.arguments();
+
+	QString root = args.count() > 1 ? args.at(1) : QDir::tempPath()+"/copybench";
+	int files	 = args.count() > 2 ? args.at(2).toInt() : qtBenchFiles;
+	int large	 = args.count() > 3 ? args.at(3).toInt() : qtBenchLarge;
+	QTextStream out(stdout);
+
+	QString source = root+"/source";
+	QString target = root+"/target";
+
+	out << QString("creating %1 files (%2 large) in %3 ...\n").arg(files+large).arg(large).arg(QDir::toNativeSeparators(root));
+	out.flush();
+
+	removeTree(root);
+	qint64 bytes = createTree(source, qMax(files, 0), qMax(large, 0));
+	if (bytes < 0)
+	{
+		out << "couldn't create the source tree\n";
+		return 1;
+	}
+
+	QtCompile compile(NULL); // ... no main window; nothing is filtered, nothing cancelled.
+	int serialCount, parallelCount;
+	QString serial, parallel;
+
+	qint64 serialMs   = copyTree(&compile, source, target, 1, serialCount, serial);
+	qint64 parallelMs = copyTree(&compile, source, target, 0, parallelCount, parallel);
+
+	out << QString("%1 MB in %2 files\n").arg(bytes/MBYTE, 0, FMT_F, 1).arg(files+large);
+	out << QString("serial:   %1 ms, %2 files ... %3\n").arg(serialMs).arg(serialCount).arg(serial);
+	out << QString("parallel: %1 ms, %2 files ... %3\n").arg(parallelMs).arg(parallelCount).arg(parallel);
+	out << QString("speed-up: %1x\n").arg(qreal(serialMs)/qMax(parallelMs, (qint64)1), 0, FMT_F, 2);
+
+	removeTree(root);
+	return serialCount == parallelCount && serialCount ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+TARGET	 = filterbench
+TEMPLATE = app
+QT      += core gui
+
+CONFIG	+= console
+CONFIG	-= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+	../../filters.cpp
@@ -0,0 +1,146 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+//
+// stand-alone microbenchmark of PathFilter (see filters.cpp) against the former linear
+// scans, i.e. "endsWith" over the folder list and the suffix looked up in a QStringList;
+// both run over the same synthetic paths, made of Qt source like folder and file names.
+//
+// usage: filterbench [paths] [rounds]
+//
+const int  qtBenchPaths  = 200000;
+const int  qtBenchRounds = 5;
+const QString qtBenchRoot("C:/Qt/4.8.7");
+
+const QStringList qtBenchDirs = QStringList()
+	<< "src" << "corelib" << "tools" << "gui" << "kernel" << "painting" << "network"
+	<< "plugins" << "imageformats" << "3rdparty" << "zlib" << "mkspecs" << "win32-msvc2010"
+	<< "tests" << "auto" << "qstring" << "widgets" << "styles" << "util" << "include"
+	<< "demos" << "doc" << "examples" << "webkit" << "phonon" << "qt3support" << "tmp";
+
+const QStringList qtBenchExts = QStringList()
+	<< "cpp" << "h" << "c" << "pro" << "pri" << "png" << "qm" << "ui" << "qrc" << "txt"
+	<< "dll" << "lib" << "pdb" << "prl" << "obj" << "exe" << "conf" << "html" << "Cpp" << "";
+
+struct BenchPath { QString dir; QString file; bool root; };
+
+bool oldFilterDir(const QStringList &filter, const QString &dirPath, bool isRoot)
+{
+	FOR_CONST_IT(filter)
+	{
+		if (!isRoot && (*IT).startsWith(SLASH))
+			continue;
+		if (dirPath.endsWith(*IT))
+			return true;
+	}
+	return false;
+}
+
+bool oldFilterExt(const QStringList &filter, const QString &fileName)
+{
+	return filter.contains(QFileInfo(fileName).suffix().toLower());
+}
+
+const QList<BenchPath> benchPaths(int count)
+{
+	qsrand(4711); // ... the same paths on every run.
+
+	QList<BenchPath> paths;
+	for(int i = 0; i < count; i++)
+	{
+		BenchPath p;
+		int depth = 1+qrand()%6;
+		p.dir = qtBenchRoot;
+		for(int d = 0; d < depth; d++)
+			p.dir += SLASH+qtBenchDirs.at(qrand()%qtBenchDirs.count());
+		p.root = depth == 1;
+
+		QString ext = qtBenchExts.at(qrand()%qtBenchExts.count());
+		p.file = QString("file%1%2").arg(i).arg(ext.isEmpty() ? ext : "."+ext);
+		paths.append(p);
+	}
+	return paths;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QStringList args = a.arguments();
+
+	int count  = args.count() > 1 ? args.at(1).toInt() : qtBenchPaths;
+	int rounds = args.count() > 2 ? args.at(2).toInt() : qtBenchRounds;
+	QTextStream out(stdout);
+
+	QList<BenchPath> paths = benchPaths(qMax(1, count));
+	QStringList dirs = sfilter+tfilter;
+	QStringList exts = ffilter+cfilter;
+
+	PathFilter filter;
+	filter.compile(dirs, exts);
+
+	qint64 oldNs = 0, newNs = 0;
+	int oldHits = 0, newHits = 0, differ = 0;
+	QElapsedTimer t;
+
+	for(int r = 0; r < qMax(1, rounds); r++)
+	{
+		oldHits = newHits = differ = 0;
+
+		t.start();
+		QVector<bool> old(paths.count());
+		for(int i = 0; i < paths.count(); i++)
+		{
+			const BenchPath &p = paths.at(i);
+			old[i] = oldFilterDir(dirs, p.dir, p.root) || oldFilterExt(exts, p.file);
+			oldHits += old.at(i);
+		}
+		oldNs += t.nsecsElapsed();
+
+		t.start();
+		QVector<bool> now(paths.count());
+		for(int i = 0; i < paths.count(); i++)
+		{
+			const BenchPath &p = paths.at(i);
+			now[i] = filter.matchDir(p.dir, p.root) || filter.matchExt(p.file);
+			newHits += now.at(i);
+		}
+		newNs += t.nsecsElapsed();
+
+		for(int i = 0; i < paths.count(); i++)
+			differ += old.at(i) != now.at(i);
+	}
+
+	qreal entries = qreal(paths.count())*qMax(1, rounds);
+	out << QString("%1 paths x %2 rounds, %3 folder and %4 extension patterns\n")
+		.arg(paths.count()).arg(qMax(1, rounds)).arg(dirs.count()).arg(exts.count());
+	out << QString("linear scan: %1 ns/entry (%2 filtered)\n").arg(oldNs/entries, 0, 'f', 1).arg(oldHits);
+	out << QString("PathFilter:  %1 ns/entry (%2 filtered)\n").arg(newNs/entries, 0, 'f', 1).arg(newHits);
+	out << QString("speed-up:    %1x, %2 results differ\n").arg(qreal(oldNs)/qMax((qint64)1, newNs), 0, 'f', 2).arg(differ);
+	return differ ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QDataStream>
+#include <QThread>
+
+const quint32 qtBuilderConfCacheMagic	= 0x51544343;
+const quint32 qtBuilderConfCacheVersion = 1;
+const int	  qtBuilderConfCacheSlack	= 2;	// ... seconds; file time resolution of the scratch volume
+//
+// configure writes the same Makefiles, qconfig.h, .qmake.cache, forwarding headers and qmake
+// binary for the same inputs; all files it created or touched in the build tree are archived
+// after a successful run and simply written back on the next run with an identical key.
+//
+const QByteArray ConfigureCache::key(const QString &config, const QString &mkSpec, const QProcessEnvironment &env, const QByteArray &sources)
+{
+	QCryptographicHash h(QCryptographicHash::Md5);
+	h.addData(config.toUtf8());
+	h.addData(mkSpec.toUtf8());
+
+	QStringList e = env.toStringList();
+	e.sort();
+	FOR_CONST_IT(e) // ... TEMP/TMP and the compiler shim stats are lane specific and don't make it into any output.
+		if (!(*IT).startsWith("TEMP=", Qt::CaseInsensitive) && !(*IT).startsWith("TMP=", Qt::CaseInsensitive) && !(*IT).startsWith("QTBUILDER_CC_STATS="))
+			h.addData((*IT).toUtf8());
+
+	h.addData(sources);
+	return h.result().toHex();
+}
+
+const QByteArray ConfigureCache::fingerprint(const QString &source)
+{	//
+	// the whole tree in name order: each file's relative path, size and time (a file edited
+	// in place leaves its directory's time as it is); taken once per run, see QtCompile::loop.
+	//
+	QCryptographicHash h(QCryptographicHash::Md5);
+	QStringList dirs(source);
+	int root = source.length()+1;
+
+	while(!dirs.isEmpty())
+	{
+		QFileInfoList entries = QDir(dirs.takeLast()).entryInfoList(
+			QDir::AllEntries|QDir::NoDotAndDotDot|QDir::Hidden|QDir::NoSymLinks, QDir::Name);
+		FOR_CONST_IT(entries)
+		{
+			QString path = (*IT).absoluteFilePath();
+			if ((*IT).isDir())
+			{
+				dirs.append(path);
+				h.addData(QString("%1/").arg(path.mid(root)).toUtf8());
+			}
+			else
+				h.addData(QString("%1|%2|%3").arg(path.mid(root)).arg((*IT).size()).arg((*IT).lastModified().toMSecsSinceEpoch()).toUtf8());
+		}
+	}
+	return h.result().toHex();
+}
+
+bool ConfigureCache::restore(const QString &filePath, const QString &root, int &count)
+{
+	count = 0;
+	QFile file(filePath);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream s(&file);
+	quint32 magic, version, files;
+	s >> magic >> version >> files;
+
+	if (s.status() != QDataStream::Ok || magic != qtBuilderConfCacheMagic || version != qtBuilderConfCacheVersion)
+		return false;
+
+	QString path;
+	QByteArray data;
+	for(quint32 i = 0; i < files; i++)
+	{
+		s >> path >> data;
+		if (s.status() != QDataStream::Ok)
+			return false;
+
+		QString target = root+SLASH+path;
+		QString dir = QFileInfo(target).absolutePath();
+		if (!QDir(dir).exists() && !QDir().mkpath(dir))
+			return false;
+
+		QFile out(target);
+		if (!out.open(QIODevice::WriteOnly) || out.write(qUncompress(data)) < 0)
+			return false;
+		count++;
+	}
+	return true;
+}
+
+bool ConfigureCache::store(const QString &filePath, const QString &root, const QDateTime &since, int &count, const QStringList &only)
+{
+	count = 0;
+	QString dir = QFileInfo(filePath).absolutePath();
+	if (!QDir(dir).exists() && !QDir().mkpath(dir))
+		return false;
+
+	QString temp = QString("%1.%2.tmp").arg(filePath).arg(qHash(QThread::currentThread()));
+	QFile file(temp);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+
+	QDataStream s(&file);
+	s << qtBuilderConfCacheMagic << qtBuilderConfCacheVersion << (quint32)0;
+
+	QDir base(root);
+	QDateTime from = since.addSecs(-qtBuilderConfCacheSlack);
+	QDirIterator it(root, QDir::Files|QDir::Hidden|QDir::System|QDir::NoSymLinks, QDirIterator::Subdirectories);
+	while(it.hasNext())
+	{
+		it.next();
+		QFileInfo info = it.fileInfo();
+		if (info.lastModified() < from || info.fileName() == msBuildTool || info.suffix() == "log" || info.completeSuffix().startsWith("log."))
+			continue; // ... the build log (and its index) is written during configure too.
+
+		QString path = base.relativeFilePath(info.absoluteFilePath());
+		bool skip = !only.isEmpty();
+		FOR_CONST_IT(only)
+			if (path.startsWith(*IT, Qt::CaseInsensitive))
+			{	skip = false;
+				break;
+			}
+		if (skip)
+			continue;
+
+		QFile in(info.absoluteFilePath());
+		if (!in.open(QIODevice::ReadOnly))
+			continue;
+
+		s << path << qCompress(in.readAll());
+		count++;
+	}
+
+	bool result = s.status() == QDataStream::Ok && count;
+	if (result)
+	{	file.seek(sizeof(quint32)*2);
+		s << (quint32)count;
+	}
+	file.close();
+
+	QFile::remove(filePath);
+	if (result && QFile::rename(temp, filePath))
+		return true;
+
+	QFile::remove(temp);
+	return false;
+}
@@ -0,0 +1,286 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#ifdef _WIN32
+#include "windows.h"
+#endif
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#endif
+
+const QStringList qtBuilderCopyMethods = QStringList()
+	<< "reflink"
+	<< "copy_file_range"
+	<< "sendfile"
+	<< "CopyFile"
+	<< "buffered"
+;
+const qint64 qtBuilderCopyBlock = 1024*1024;
+//
+// note: the copy method is picked per (source, target) file system pair; every pair starts
+// with the cheapest one (reflink), and falls back to the next method as soon as the kernel
+// reports it to be unsupported for that pair. the result is kept for the rest of the copy.
+//
+CopyBackend::CopyBackend()
+{
+#ifdef Q_OS_LINUX
+	m_range = CopyRange;
+#else
+	m_range = Buffered;
+#endif
+}
+
+const QString CopyBackend::summary() const
+{
+	QStringList s;
+	for(int i = 0; i < Methods; i++)
+		if (int count = m_counts[i])
+			s.append(QString("%1 %2").arg(qtBuilderCopyMethods.at(i)).arg(count));
+	return s.join(", ");
+}
+
+int CopyBackend::first(quint64 srcDev, quint64 tgtDev)
+{
+	QMutexLocker l(&m_mutex);
+	return m_pairs.value(qMakePair(srcDev, tgtDev), Reflink);
+}
+
+void CopyBackend::next(quint64 srcDev, quint64 tgtDev, int method)
+{
+	QMutexLocker l(&m_mutex);
+	QPair<quint64, quint64> pair = qMakePair(srcDev, tgtDev);
+	m_pairs.insert(pair, qMax(method, m_pairs.value(pair, Reflink)));
+
+	if (method > Reflink)
+		m_cloning = 0;
+}
+
+#ifdef Q_OS_LINUX
+static bool qtBuilderUnsupported(int error)
+{
+	return error == EXDEV || error == EOPNOTSUPP || error == ENOTTY ||
+		   error == EINVAL || error == ENOSYS || error == EPERM;
+}
+
+static bool qtBuilderRewind(int in, int out)
+{
+	return lseek(in, 0, SEEK_SET) == 0 && lseek(out, 0, SEEK_SET) == 0 && !ftruncate(out, 0);
+}
+
+static bool qtBuilderBuffered(int in, int out, off_t offset, qint64 length)
+{
+	QByteArray buffer;
+	buffer.resize(qtBuilderCopyBlock);
+	while(length > 0)
+	{
+		ssize_t r = pread(in, buffer.data(), qMin(length, qtBuilderCopyBlock), offset);
+		if (r <= 0)
+			return false;
+
+		for(ssize_t w = 0; w < r; )
+		{
+			ssize_t n = pwrite(out, buffer.constData()+w, r-w, offset+w);
+			if (n <= 0)
+				return false;
+			w += n;
+		}
+		offset += r;
+		length -= r;
+	}
+	return true;
+}
+#endif
+
+bool CopyBackend::copy(const QString &source, const QString &target)
+{
+#ifdef Q_OS_LINUX
+	int in = open(QFile::encodeName(source).constData(), O_RDONLY|O_CLOEXEC);
+	if (in < 0)
+		return false;
+
+	struct stat src, tgt;
+	int out = fstat(in, &src) ? -1 : open(QFile::encodeName(target).constData(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, src.st_mode & 0777);
+	if (out < 0 || fstat(out, &tgt))
+	{
+		if (out >= 0) close(out);
+		close(in);
+		return false;
+	}
+
+	bool result = false;
+	qint64 left = src.st_size;
+	int method	= first(src.st_dev, tgt.st_dev);
+	int error;	// ... only set by a failing call; a call returning 0 (a short copy) leaves errno stale.
+
+	for(; method < Buffered && !result; method++)
+	{
+		error = 0;
+		switch(method)
+		{
+		case Reflink:
+			if (!(result = !ioctl(out, FICLONE, in)))
+				error = errno;
+			break;
+
+		case CopyRange:
+			for(left = src.st_size; left > 0; )
+			{
+				ssize_t n = copy_file_range(in, NULL, out, NULL, left, 0);
+				if (n <= 0)
+				{	error = n ? errno : 0;
+					break;
+				}
+				left -= n;
+			}
+			result = !left;
+			break;
+
+		case SendFile:
+			for(left = src.st_size; left > 0; )
+			{
+				ssize_t n = sendfile(out, in, NULL, left);
+				if (n <= 0)
+				{	error = n ? errno : 0;
+					break;
+				}
+				left -= n;
+			}
+			result = !left;
+			break;
+
+		default:
+			continue;
+		}
+		if (result)
+			break;
+
+		if ((error && !qtBuilderUnsupported(error)) || !qtBuilderRewind(in, out))
+		{
+			close(out);
+			close(in);
+			return false;
+		}
+		if (error) // ... a short copy falls back for this file only.
+			next(src.st_dev, tgt.st_dev, method+1);
+	}
+	if (!result)
+		result = qtBuilderBuffered(in, out, 0, src.st_size);
+
+	if (result)
+	{
+		struct timespec times[2];
+		times[0] = src.st_atim;
+		times[1] = src.st_mtim;
+		result = !futimens(out, times);
+
+		if (method == Reflink)
+			m_cloning = 1;
+		counted(qMin(method, (int)Buffered));
+	}
+	close(out);
+	close(in);
+	return result;
+#else
+#ifdef _WIN32
+	QString src = QDir::toNativeSeparators(source);
+	QString tgt = QDir::toNativeSeparators(target);
+	if (CopyFileW((LPCWSTR)src.utf16(), (LPCWSTR)tgt.utf16(), FALSE))
+	{	// ... CopyFile is done by the file system driver (incl. block cloning on ReFS)
+		counted(SystemCopy);
+		return true;
+	}
+#endif
+	if (!QFile::copy(source, target) || !copyFileTime(source, target))
+		return false;
+
+	counted(Buffered);
+	return true;
+#endif
+}
+
+bool CopyBackend::copyRange(const QString &source, const QString &target, qint64 offset, qint64 length)
+{	//
+	// used for chunked copies; the target is already pre-allocated. without any range
+	// support of the kernel this is the plain buffered read/write at the given offset.
+	//
+#ifdef Q_OS_LINUX
+	int in  = open(QFile::encodeName(source).constData(), O_RDONLY|O_CLOEXEC);
+	int out = open(QFile::encodeName(target).constData(), O_WRONLY|O_CLOEXEC);
+	bool result = in >= 0 && out >= 0;
+
+	if (result && m_range == CopyRange)
+	{
+		loff_t i = offset, o = offset;
+		qint64 left = length;
+		int error = 0;
+		while(left > 0)
+		{
+			ssize_t n = copy_file_range(in, &i, out, &o, left, 0);
+			if (n <= 0)
+			{	error = n ? errno : 0; // ... 0 is a short copy; the rest goes buffered.
+				break;
+			}
+			left -= n;
+		}
+		if (error && qtBuilderUnsupported(error))
+			m_range = Buffered;
+
+		offset += length-left;
+		length  = left;
+	}
+	if (result && length)
+		result = qtBuilderBuffered(in, out, offset, length);
+
+	if (out >= 0) close(out);
+	if (in  >= 0) close(in);
+	return result;
+#else
+	QFile src(source);
+	QFile tgt(target);
+	if (!src.open(QIODevice::ReadOnly) || !src.seek(offset) ||
+		!tgt.open(QIODevice::ReadWrite) || !tgt.seek(offset))
+		return false;
+
+	QByteArray buffer;
+	while(length > 0)
+	{
+		buffer = src.read(qMin(length, qtBuilderCopyBlock));
+		if (buffer.isEmpty() || tgt.write(buffer) != buffer.size())
+			return false;
+		length -= buffer.size();
+	}
+	return true;
+#endif
+}
@@ -0,0 +1,436 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QThread>
+
+const int	 qtBuilderCopyThreads = 0;				// ... 0 uses the ideal thread count; 1 is the plain serial copying (i.e. for comparing the throughput).
+const int	 qtBuilderCopyQueue	  = 4096;			// ... max. number of pending file jobs; the scanner waits as long the workers are behind.
+const int	 qtBuilderRemoveBatch = 256;			// ... synchronize removals are collected and handed to the workers in batches of this size.
+const qint64 qtBuilderCopyChunk	  = 32*1024*1024;	// ... files larger than two chunks get split up between the copy workers (unless cloned).
+const int	 qtBuilderProgressMs  = 15;
+
+class CopyWorker : public QRunnable
+{
+public:
+	CopyWorker(CopyEngine *engine, int index) : m_engine(engine), m_index(index) {}
+	void run() { m_engine->work(m_index); }
+
+private:
+	CopyEngine *m_engine;
+	int m_index;
+};
+
+CopyEngine::CopyEngine(QtCompile *compile, bool synchronize, bool skipRootFiles, SourceManifest *manifest, int threads) :
+	m_compile(compile), m_manifest(manifest), m_synchronize(synchronize), m_skipRootFiles(skipRootFiles), m_scanning(false),
+	m_emitted(0), m_bytes(0), m_msecs(0), m_count(0), m_to(-1), m_next(0), m_scanned(0), m_maximum(0)
+{
+	m_removeFiles.type = CopyTask::RemoveFiles;
+	m_removeDirs .type = CopyTask::RemoveDirs;
+
+	int count = threads ? threads : qtBuilderCopyThreads; // ... an explicit count is used by the copy benchmark.
+	if (!count)
+		count = QThread::idealThreadCount();
+	for(int i = 0; i < qMax(count, 1); i++)
+		m_queues.append(new WorkQueue);
+
+	m_filter = m_compile->m_filter.hasExtensions();
+}
+
+CopyEngine::~CopyEngine()
+{
+	qDeleteAll(m_queues);
+}
+
+int CopyEngine::run(int to, const QString &source, const QString &target, int maximum)
+{	//
+	// the calling thread is the scanner: it walks the folders, does the synchronize part and
+	// feeds the file jobs to the workers, who start copying while the scan is still going on.
+	//
+	m_to = to;
+	m_maximum = maximum;
+	m_scanning = true;
+	m_timer.start();
+
+	QThreadPool pool; // ... not the global one; that one is running the build loop!
+	pool.setMaxThreadCount(threads());
+	for(int i = 0; i < threads(); i++)
+		pool.start(new CopyWorker(this, i));
+
+	scan(source, target);
+	{
+		QMutexLocker l(&m_idle);
+		m_scanning = false;
+		m_wake.wakeAll();
+	}
+	pool.waitForDone();
+
+	m_msecs = m_timer.elapsed();
+	return m_failed ? 0 : m_count;
+}
+
+const QString CopyEngine::summary() const
+{
+	qreal mb = m_bytes/MBYTE;
+	qreal secs = m_msecs/1000.0;
+	return QString("%1 MB in %2 s ... %3 MB/s (%4 threads)")
+		.arg(mb,0,FMT_F,1).arg(secs,0,FMT_F,1).arg(secs ? mb/secs : mb,0,FMT_F,1).arg(threads());
+}
+
+void CopyEngine::work(int index)
+{
+	CopyTask task;
+	while(take(index, task))
+	{
+		switch(task.type)
+		{
+		case CopyTask::File:		copyFile(index, task); break;
+		case CopyTask::Chunk:		copyChunk(task);	   break;
+		case CopyTask::RemoveFiles:
+		case CopyTask::RemoveDirs:	remove(task);		   break;
+		}
+		done();
+	}
+}
+
+void CopyEngine::push(int index, const CopyTask &task, bool bounded)
+{
+	if (bounded)
+	{	// ... only the scanner waits; workers pushing chunks must never block here!
+		QMutexLocker l(&m_idle);
+		while(m_pending >= qtBuilderCopyQueue && !m_failed && !m_compile->cancelled())
+			m_space.wait(&m_idle, 50);
+	}
+	m_pending.ref();
+	{	WorkQueue *q = m_queues.at(index);
+		QMutexLocker l(&q->mutex);
+		q->tasks.append(task);
+	}
+	QMutexLocker l(&m_idle);
+	m_wake.wakeOne();
+}
+
+bool CopyEngine::take(int index, CopyTask &task)
+{	//
+	// work stealing: each worker takes the newest task of its own queue (a chunk it just has
+	// split up, or the latest file fed by the scanner), but steals the oldest one of others.
+	//
+	int count = threads();
+	forever
+	{
+		if (m_failed || m_compile->cancelled())
+			return false;
+
+		for(int i = 0; i < count; i++)
+		{
+			WorkQueue *q = m_queues.at((index+i)%count);
+			QMutexLocker l(&q->mutex);
+			if (q->tasks.isEmpty())
+				continue;
+
+			task = i ? q->tasks.takeFirst() : q->tasks.takeLast();
+			return true;
+		}
+
+		QMutexLocker l(&m_idle);
+		if (!m_pending && !m_scanning)
+			return false;
+		m_wake.wait(&m_idle, 50);
+	}
+}
+
+void CopyEngine::done()
+{
+	bool idle = !m_pending.deref();
+
+	QMutexLocker l(&m_idle);
+	m_space.wakeOne();
+	if (idle)
+		m_wake.wakeAll();
+}
+
+bool CopyEngine::fail(const QString &msg, const QString &path)
+{
+	if (m_failed.testAndSetOrdered(0, 1))
+		m_compile->log(msg, QDir::toNativeSeparators(path), Elevated);
+	return false;
+}
+
+void CopyEngine::counted(const QString &native, qint64 size)
+{
+	QMutexLocker l(&m_stats);
+	m_count++;
+	m_bytes += size;
+
+	qint64 e = m_timer.elapsed();
+	if (e && e-m_emitted >= qtBuilderProgressMs)
+	{
+		m_emitted = e;
+		emit m_compile->progress(m_count, native, m_bytes/MBYTE*1000/e);
+	}
+}
+
+void CopyEngine::scan(const QString &source, const QString &target)
+{
+	QQueue<CopyTask> queue;
+	CopyTask root;
+	root.source = source;
+	root.target = target;
+	queue.enqueue(root);
+
+	while(!queue.isEmpty())
+	{
+		if (m_failed || m_compile->cancelled())
+			return;
+
+		if (!scanFolder(queue.dequeue(), queue))
+			return;
+	}
+	flushRemovals(true);
+
+	if (m_scanned != m_maximum)
+		emit m_compile->diskOp(m_to, true, m_maximum = m_scanned);
+}
+
+bool CopyEngine::scanFolder(const CopyTask &task, QQueue<CopyTask> &queue)
+{
+	QDir desDir(task.target);
+
+	if (m_compile->filterDir(task.source, task.depth == 1))
+	{
+		if (m_synchronize && desDir.exists() &&
+		   !m_compile->removeDir(desDir.absolutePath()))
+			return fail("Synchronize faild; couldn't remove:", desDir.absolutePath());
+		return true;
+	}
+
+	bool fresh = !desDir.exists();
+	if (fresh && !QDir().mkpath(desDir.absolutePath()))
+		return fail("Couldn't create folder:", desDir.absolutePath());
+
+	ManifestDir srcDir;
+	if (m_manifest ? !m_manifest->listing(task.source, srcDir)
+				   : !SourceManifest::scan(task.source, srcDir))
+		return fail("Couldn't read folder:", task.source);
+
+	if (!task.depth && m_skipRootFiles)
+		srcDir.files.clear();
+	//
+	// a single listing of the target folder, hashed by name; every source entry takes its
+	// counterpart out of it, so whatever is left afterwards is to be removed (if synchronizing).
+	//
+	QHash<QString, QFileInfo> target;
+	if (!fresh)
+	{
+		QFileInfoList dinfo = desDir.entryInfoList(QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot);
+		FOR_CONST_IT(dinfo)
+			target.insert((*IT).fileName(), *IT);
+	}
+
+	QString srcd  = task.source+SLASH;
+	QString destd = desDir.absolutePath()+SLASH;
+	QString nme;
+	QFileInfo des;
+
+	FOR_CONST_IT(srcDir.files)
+	{
+		if (m_compile->cancelled())
+			return true;
+
+		nme = (*IT).name;
+		if (m_filter && m_compile->filterExt(nme))
+			continue;
+
+		CopyTask file;
+		file.type	= CopyTask::File;
+		file.source = srcd +nme;
+		file.target = destd+nme;
+		file.size	= (*IT).size;
+		file.mtime	= (*IT).mtime;
+
+		if (file.target.length() > 256)
+			return fail("Path length exceeded", file.target);
+
+		m_scanned++;
+		if ((file.replace = target.contains(nme)))
+		{
+			des = target.take(nme);
+			if (des.isDir())
+			{
+				if (!m_compile->removeDir(des.absoluteFilePath()))
+					return fail("Couldn't replace old folder:", des.absoluteFilePath());
+				file.replace = false;
+			}
+			else if (des.size() == file.size &&
+					 des.lastModified().toMSecsSinceEpoch() == file.mtime)
+			{
+				counted(QDir::toNativeSeparators(file.target), file.size);
+				continue;
+			}
+		}
+		push(m_next, file, true);
+		m_next = (m_next+1)%threads();
+	}
+
+	FOR_CONST_IT(srcDir.dirs)
+	{
+		nme = *IT;
+		if (target.contains(nme) && !(des = target.take(nme)).isDir() &&
+			!QFile(des.absoluteFilePath()).remove())
+			return fail("Couldn't replace old file:", des.absoluteFilePath());
+
+		CopyTask sub;
+		sub.depth  = task.depth+1;
+		sub.source = srcd +nme;
+		sub.target = destd+nme;
+		queue.enqueue(sub);
+	}
+
+	if (m_scanned > m_maximum)
+	{	// ... the cached count from the last run was too low; this gets exact as soon the scan is done.
+		m_maximum = m_scanned+m_scanned/10;
+		emit m_compile->diskOp(m_to, true, m_maximum);
+	}
+
+	if (m_synchronize)
+	{
+		FOR_CONST_IT(target)
+			removeLater(*IT);
+		flushRemovals(false);
+	}
+	return true;
+}
+
+void CopyEngine::removeLater(const QFileInfo &info)
+{
+	CopyTask &batch = info.isDir() ? m_removeDirs : m_removeFiles;
+	batch.batch.append(info.absoluteFilePath());
+}
+
+void CopyEngine::flushRemovals(bool all)
+{
+	CopyTask *batches[] = { &m_removeFiles, &m_removeDirs };
+	for(int i = 0; i < 2; i++)
+	{
+		CopyTask *batch = batches[i];
+		if (batch->batch.count() < (all ? 1 : qtBuilderRemoveBatch))
+			continue;
+
+		push(m_next, *batch, true);
+		m_next = (m_next+1)%threads();
+		batch->batch.clear();
+	}
+}
+
+bool CopyEngine::remove(const CopyTask &task)
+{
+	FOR_CONST_IT(task.batch)
+	{
+		if (m_compile->cancelled())
+			return true;
+
+		if (task.type == CopyTask::RemoveDirs ? !m_compile->removeDir(*IT) : !QFile::remove(*IT))
+			return fail("Synchronize failed; couldn't remove:", *IT);
+	}
+	return true;
+}
+
+bool CopyEngine::copyFile(int index, const CopyTask &task)
+{
+	counted(QDir::toNativeSeparators(task.target), task.size);
+	//
+	// the size may be taken from the source manifest, which trusts unchanged folders; a file
+	// rewritten in place is missed by that, thus the chunks are laid out by a fresh stat.
+	//
+	bool chunked = threads() > 1 && task.size > 2*qtBuilderCopyChunk && !m_backend.cloning();
+	qint64 size  = chunked ? QFileInfo(task.source).size() : task.size;
+	chunked &= size > 2*qtBuilderCopyChunk;
+
+	if (task.replace && !QFile(task.target).remove())
+	{
+		return fail("Couldn't replace old file:", task.target);
+	}
+	else if (chunked)
+	{
+		if (!copyChunked(index, task.source, size, task.target))
+			return fail("Couldn't copy new file:", task.target);
+	}
+	else if (!m_backend.copy(task.source, task.target))
+	{
+		return fail("Couldn't copy new file:", task.target);
+	}
+	return true;
+}
+
+bool CopyEngine::copyChunked(int index, const QString &src, qint64 size, const QString &tgt)
+{	//
+	// the target is pre-allocated here; the chunks are pushed to the own queue, from where
+	// idle workers steal them. whoever finishes the last chunk sets the source permissions
+	// and timestamps (the pre-allocated target has default ones).
+	//
+	{	QFile file(tgt);
+		if (!file.open(QIODevice::WriteOnly) || !file.resize(size))
+			return false;
+	}
+
+	int parts = (int)((size+qtBuilderCopyChunk-1)/qtBuilderCopyChunk);
+
+	CopyTask chunk;
+	chunk.type	 = CopyTask::Chunk;
+	chunk.source = src;
+	chunk.target = tgt;
+	chunk.parts	 = QSharedPointer<QAtomicInt>(new QAtomicInt(parts));
+
+	for(qint64 offset = 0; offset < size; offset += qtBuilderCopyChunk)
+	{
+		chunk.offset = offset;
+		chunk.length = qMin(qtBuilderCopyChunk, size-offset);
+		push(index, chunk);
+	}
+	return true;
+}
+
+bool CopyEngine::copyChunk(const CopyTask &task)
+{
+	if (m_compile->cancelled())
+		return true;
+
+	if (!m_backend.copyRange(task.source, task.target, task.offset, task.length))
+		return fail("Couldn't copy new file:", task.target);
+
+	if (task.parts->deref())
+		return true;
+
+	if (!QFile::setPermissions(task.target, QFile::permissions(task.source)))
+		return fail("Couldn't set file permissions:", task.target);
+
+	if (!copyFileTime(task.source, task.target))
+		return fail("Couldn't set file time:", task.target);
+
+	m_backend.counted(m_backend.rangeMethod());
+	return true;
+}
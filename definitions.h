@@ -81,6 +81,17 @@ const QStringList cfilter = QStringList() /* lower case! */
 	<< "c"
 	<< "cpp"
 ;
+const QStringList htools = QStringList() /* host tools; built ahead of everything else */
+	<< "sub-tools-bootstrap"
+	<< "sub-moc"
+	<< "sub-rcc"
+	<< "sub-uic"
+;
+const QStringList hpaths = QStringList() /* host tool output; relative to the build folder */
+	<< "bin/"
+	<< "lib/"
+	<< "src/tools/"
+;
 const QStringList targets = QStringList() /* used if the according global bool is set */
 	<< "sub-tools-bootstrap"
 	<< "sub-moc"
@@ -219,6 +230,11 @@ const QString registryTrl("HKEY_CURRENT_USER\\Software\\Trolltech\\Versions");
 
 const QString qtBuildTemp("_btmp");
 const QString qtBuildMain("_build");
+const QString qtBuildPubl("_publish");
+const QString qtBuildManif("_source.manifest");
+const QString qtBuildTrash("_trash");
+const QString qtBuildCache("_cache");
+const QString qtBuildProv("qtbuilder.provenance");
 const QString qtVarScript("/bin/qtvars.bat");
 const QString imdiskDrive("Drive letter:");
 const QString imdiskSizeS("Size:");
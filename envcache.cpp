@@ -0,0 +1,140 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QThread>
+
+const quint32 qtBuilderEnvCacheMagic   = 0x51544556;
+const quint32 qtBuilderEnvCacheVersion = 1;
+//
+// the toolchain environment only depends on the toolchain script (and its arguments) and
+// on the base path it is run with; the captured "set" dump is stored as a diff against the
+// system environment: unchanged entries are kept by name only and taken from the current
+// system environment on load, thus a changed user variable is never replayed stale.
+//
+const QByteArray EnvironmentCache::key(const QString &call, const QString &script, const QStringList &base)
+{
+	QFileInfo info(script);
+	if (!info.exists())
+		return QByteArray();
+
+	QCryptographicHash h(QCryptographicHash::Md5);
+	h.addData(call.toUtf8());
+	h.addData(QString::number(info.lastModified().toMSecsSinceEpoch()).toUtf8());
+	h.addData(QString::number(info.size()).toUtf8());
+	h.addData(base.join(___LF).toUtf8());
+	return h.result().toHex();
+}
+
+bool EnvironmentCache::valid(const QStringList &lines)
+{	//
+	// a toolchain script that failed (but exited with 0) leaves the build variables unset.
+	//
+	QStringList needed = QStringList() << "PATH";
+#ifdef _WIN32
+	needed << "INCLUDE" << "LIB";
+#endif
+	QSet<QString> names;
+	FOR_CONST_IT(lines)
+		if ((*IT).contains("=") && !(*IT).section('=', 1).isEmpty())
+			names.insert((*IT).section('=', 0, 0).toUpper());
+
+	FOR_CONST_IT(needed)
+		if (!names.contains(*IT))
+			return false;
+	return true;
+}
+
+bool EnvironmentCache::load(const QString &filePath, const QByteArray &key, QStringList &lines)
+{
+	QFile file(filePath);
+	if (key.isEmpty() || !file.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream s(&file);
+	quint32 magic, version;
+	QByteArray k;
+	QStringList same, changed;
+	s >> magic >> version >> k >> same >> changed;
+
+	if (s.status() != QDataStream::Ok || magic != qtBuilderEnvCacheMagic ||
+		version != qtBuilderEnvCacheVersion || k != key)
+		return false;
+
+	QHash<QString, QString> system;
+	QStringList e = QProcess::systemEnvironment();
+	FOR_CONST_IT(e)
+		system.insert((*IT).section('=', 0, 0), *IT);
+
+	lines = changed;
+	FOR_CONST_IT(same)
+	{
+		if (!system.contains(*IT))
+			return false; // ... the system environment changed meanwhile; capture it again.
+		lines.append(system.value(*IT));
+	}
+	return valid(lines); // ... i.e. an entry cached before the check was added.
+}
+
+bool EnvironmentCache::save(const QString &filePath, const QByteArray &key, const QStringList &lines)
+{
+	if (key.isEmpty() || !valid(lines))
+		return false;
+
+	QString dir = QFileInfo(filePath).absolutePath();
+	if (!QDir(dir).exists() && !QDir().mkpath(dir))
+		return false;
+
+	QSet<QString> system = QProcess::systemEnvironment().toSet();
+	QStringList same, changed;
+	FOR_CONST_IT(lines)
+	{
+		if (!(*IT).contains("="))
+			continue;
+
+		if (system.contains(*IT))
+			 same.append((*IT).section('=', 0, 0));
+		else changed.append(*IT);
+	}
+
+	QString temp = QString("%1.%2.tmp").arg(filePath).arg(qHash(QThread::currentThread()));
+	QFile file(temp);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+
+	QDataStream s(&file);
+	s << qtBuilderEnvCacheMagic << qtBuilderEnvCacheVersion << key << same << changed;
+	file.close();
+
+	QFile::remove(filePath);
+	if (QFile::rename(temp, filePath))
+		return true;
+
+	QFile::remove(temp);
+	return false;
+}
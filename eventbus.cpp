@@ -0,0 +1,143 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QSemaphore>
+#include <QThread>
+
+const int qtBuilderBusRate = 40; // ... ms; the sinks get the queued events at this rate.
+//
+// worker threads (the compile loop, its lanes and the copy engines) post events without waiting
+// for the gui; the queue is a linked list where producers only swap the head and the consumer
+// (the gui thread) owns the tail, thus posting never takes a lock. events are handed to the
+// sinks in the order of posting; a state transition (current) waits until everything before
+// and including it has been handled, like the blocking connections did for every single event.
+//
+struct BusNode
+{
+	BusNode() : done(NULL) {}
+
+	QAtomicPointer<BusNode> next;
+	QSemaphore *done;
+	BusEvent event;
+};
+
+EventBus::EventBus(QObject *parent) : QObject(parent)
+{
+	m_tail = new BusNode;
+	m_head = m_tail;
+
+	connect(&m_frame, SIGNAL(timeout()), this, SLOT(drain()));
+	m_frame.start(qtBuilderBusRate);
+}
+
+EventBus::~EventBus()
+{
+	while(m_tail)
+	{
+		BusNode *next = m_tail->next.fetchAndAddAcquire(0);
+		if (m_tail->done)
+			m_tail->done->release();
+		delete m_tail;
+		m_tail = next;
+	}
+}
+
+void EventBus::attach(EventSink *sink)
+{
+	m_sinks.append(sink);
+}
+
+void EventBus::log(const QString &msg, int type)
+{
+	log(msg, QString(), type);
+}
+
+void EventBus::log(const QString &msg, const QString &text, int type)
+{
+	BusEvent e;
+	e.kind = BusEvent::Log;
+	e.msg  = msg;
+	e.text = text;
+	e.type = type;
+	post(e);
+}
+
+void EventBus::diskOp(int to, bool start, int count)
+{
+	BusEvent e;
+	e.kind	= BusEvent::DiskOp;
+	e.to	= to;
+	e.start = start;
+	e.count = count;
+	post(e);
+}
+
+void EventBus::current(const Modes &modes)
+{
+	BusEvent e;
+	e.kind	= BusEvent::Current;
+	e.modes = modes;
+	post(e, true);
+}
+
+void EventBus::post(const BusEvent &event, bool flush)
+{
+	BusNode *node = new BusNode;
+	node->event = event;
+
+	QSemaphore done;
+	bool wait = flush && QThread::currentThread() != thread();
+	if (wait)
+		node->done = &done;
+
+	BusNode *prev = m_head.fetchAndStoreAcquire(node);
+	prev->next.fetchAndStoreRelease(node);
+
+	if (flush && !wait)
+		drain(); // ... posted by the gui thread itself.
+	else if (wait)
+	{
+		CALL_QUEUED(this, drain);
+		done.acquire();
+	}
+}
+
+void EventBus::drain()
+{
+	while(BusNode *next = m_tail->next.fetchAndAddAcquire(0))
+	{
+		delete m_tail;
+		m_tail = next;
+
+		FOR_CONST_IT(m_sinks)
+			(*IT)->busEvent(next->event);
+
+		if (next->done)
+		{	next->done->release();
+			next->done = NULL;
+		}
+	}
+}
@@ -0,0 +1,147 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+//
+// the filter lists from definitions.h are compiled once per build step:
+//
+// - folder patterns go into a trie of reversed characters, so matching a path is a
+//   single walk from its end; "/name" only matches directly below the copied root,
+//   "name" matches anywhere in the tree (both as a plain "ends with", as before).
+//
+// - extensions go into a hash set; lookups are skipped by length for anything that
+//   cannot be contained anyway (most files are filtered by that alone).
+//
+// - patterns containing glob characters (i.e. "qt3*" or "/exam*") are matched as
+//   wildcards against the folder name, or the file extension respectively.
+//
+PathFilter::PathFilter() : m_extLength(0)
+{
+	m_nodes.append(Node());
+}
+
+bool PathFilter::isGlob(const QString &pattern)
+{
+	return pattern.contains('*') || pattern.contains('?') || pattern.contains('[');
+}
+
+void PathFilter::compile(const QStringList &dirs, const QStringList &exts)
+{
+	m_nodes.clear();
+	m_nodes.append(Node());
+	m_dirGlobs.clear();
+	m_extGlobs.clear();
+	m_exts.clear();
+	m_extLength = 0;
+
+	QString pattern;
+	FOR_CONST_IT(dirs)
+	{
+		pattern = *IT;
+		int anchor = pattern.startsWith(SLASH) ? Rooted : Anywhere;
+
+		if (!isGlob(pattern))
+		{
+			insert(pattern, anchor);
+			continue;
+		}
+		if (anchor == Rooted)
+			pattern.remove(0, 1);
+		m_dirGlobs.append(qMakePair(QRegExp(pattern, Qt::CaseSensitive, QRegExp::Wildcard), anchor));
+	}
+
+	FOR_CONST_IT(exts)
+	{
+		pattern = (*IT).toLower();
+		if (isGlob(pattern))
+		{
+			m_extGlobs.append(QRegExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard));
+			continue;
+		}
+		m_exts.insert(pattern);
+		m_extLength = qMax(m_extLength, pattern.length());
+	}
+}
+
+void PathFilter::insert(const QString &pattern, int anchor)
+{
+	int node = 0;
+	for(int i = pattern.length()-1; i >= 0; i--)
+	{
+		QChar c = pattern.at(i);
+		int next = m_nodes.at(node).next.value(c, -1);
+		if (next < 0)
+		{
+			next = m_nodes.count();
+			m_nodes.append(Node());
+			m_nodes[node].next.insert(c, next);
+		}
+		node = next;
+	}
+	m_nodes[node].anchor |= anchor;
+}
+
+bool PathFilter::matchDir(const QString &dirPath, bool isRoot) const
+{
+	int node = 0;
+	for(int i = dirPath.length()-1; i >= 0; i--)
+	{
+		if ((node = m_nodes.at(node).next.value(dirPath.at(i), -1)) < 0)
+			break;
+
+		int anchor = m_nodes.at(node).anchor;
+		if ((anchor & Anywhere) || ((anchor & Rooted) && isRoot))
+			return true;
+	}
+	if (m_dirGlobs.isEmpty())
+		return false;
+
+	QString name = dirPath.mid(dirPath.lastIndexOf(SLASH)+1);
+	FOR_CONST_IT(m_dirGlobs)
+	{
+		if ((*IT).second == Rooted && !isRoot)
+			continue;
+		if ((*IT).first.exactMatch(name))
+			return true;
+	}
+	return false;
+}
+
+bool PathFilter::matchExt(const QString &fileName) const
+{
+	int dot = fileName.lastIndexOf('.');
+	int len = dot < 0 ? 0 : fileName.length()-dot-1;
+
+	if (len > m_extLength && m_extGlobs.isEmpty())
+		return false;
+
+	QString ext = fileName.right(len).toLower();
+	if (m_exts.contains(ext))
+		return true;
+
+	FOR_CONST_IT(m_extGlobs)
+		if ((*IT).exactMatch(ext))
+			return true;
+	return false;
+}
@@ -0,0 +1,316 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QRegExp>
+#include <QThread>
+
+const QStringList qtBuilderGenTools = QStringList() << "moc" << "uic" << "rcc";
+//
+// moc, uic and rcc write the same files for the same inputs in every variant; the rules
+// are taken from the qmake generated Makefiles and keyed by the tool sources, the command
+// (without include paths, which differ between variants but don't change the output) and
+// the contents of all dependencies. seeded files are written after the tools were built,
+// thus they are newer than anything they depend on and make skips them.
+//
+// note: defines stay in the key, moc evaluates them; thus shared and static builds only
+// share the files of headers that come out the same, uic and rcc files are shared anyway.
+//
+struct GeneratedRule
+{
+	QString tool;
+	QString target;
+	QString command;
+	QStringList depends;
+};
+
+typedef QHash<QString, QByteArray> HashCache;
+
+static const QStringList splitTokens(const QString &line)
+{
+	QStringList tokens;
+	QString token;
+	bool quoted = false;
+	for(int i = 0; i < line.length(); i++)
+	{
+		QChar c = line.at(i);
+		if (c == '"')
+			quoted = !quoted;
+		else if (c.isSpace() && !quoted)
+		{
+			if (!token.isEmpty())
+				tokens.append(token);
+			token.clear();
+		}
+		else token += c;
+	}
+	if (!token.isEmpty())
+		tokens.append(token);
+	return tokens;
+}
+
+static const QString expandMacros(QString text, const QHash<QString, QString> &macros)
+{
+	QRegExp rx("\\$\\((\\w+)\\)");
+	int pos = 0, depth = 0;
+	while((pos = rx.indexIn(text, pos)) >= 0 && depth < 256)
+	{
+		if (!macros.contains(rx.cap(1)))
+		{
+			pos += rx.matchedLength(); // ... i.e. environment values; kept as they are.
+			continue;
+		}
+		text.replace(pos, rx.matchedLength(), macros.value(rx.cap(1)));
+		depth++;
+	}
+	return text;
+}
+
+static const QString toolName(const QString &program)
+{
+	QString name = QFileInfo(program).fileName().toLower();
+	if (name.endsWith(".exe"))
+		name.chop(4);
+	return name;
+}
+
+static QList<GeneratedRule> readMakefile(const QString &filePath)
+{
+	QList<GeneratedRule> rules;
+	QFile file(filePath);
+	if (!file.open(QIODevice::ReadOnly|QIODevice::Text))
+		return rules;
+
+	QStringList lines;
+	QString line;
+	while(!file.atEnd())
+	{	//
+		// joining continued lines; tabs in front of commands are kept!
+		//
+		QString text = QString::fromLocal8Bit(file.readLine());
+		text.chop(text.endsWith('\n') ? 1 : 0);
+		if (text.endsWith('\\'))
+		{
+			line += text.left(text.length()-1)+" ";
+			continue;
+		}
+		lines.append(line+text);
+		line.clear();
+	}
+
+	QHash<QString, QString> macros;
+	QRegExp define("^(\\w+)\\s*=(.*)$");
+	QRegExp target("^(\\S+):(\\s.*|)$");
+	QString dir = QFileInfo(filePath).absolutePath();
+
+	for(int i = 0; i < lines.count(); i++)
+	{
+		if (define.exactMatch(lines.at(i)))
+		{
+			macros.insert(define.cap(1), define.cap(2).trimmed());
+			continue;
+		}
+		if (!target.exactMatch(lines.at(i)) || i+1 >= lines.count() || !lines.at(i+1).startsWith(__TAB))
+			continue;
+
+		QString command = expandMacros(lines.at(i+1).trimmed(), macros);
+		QStringList tokens = splitTokens(command);
+		if (tokens.isEmpty() || !qtBuilderGenTools.contains(toolName(tokens.first())))
+			continue;
+
+		GeneratedRule rule;
+		rule.tool	 = toolName(tokens.first());
+		rule.target	 = QDir(dir).absoluteFilePath(QDir::fromNativeSeparators(target.cap(1)));
+		rule.command = tokens.mid(1).join(" ");
+
+		QStringList depends = splitTokens(expandMacros(target.cap(2), macros));
+		FOR_CONST_IT(depends)
+			if (!qtBuilderGenTools.contains(toolName(*IT))) // ... the tool binary is covered by its sources.
+				rule.depends.append(QDir(dir).absoluteFilePath(QDir::fromNativeSeparators(*IT)));
+
+		rules.append(rule);
+		i++;
+	}
+	return rules;
+}
+
+static QList<GeneratedRule> readMakefiles(const QString &build)
+{
+	QList<GeneratedRule> rules;
+	QDirIterator it(build, QStringList() << "Makefile*", QDir::Files, QDirIterator::Subdirectories);
+	while(it.hasNext())
+		rules += readMakefile(it.next());
+	return rules;
+}
+
+static const QByteArray fileHash(const QString &filePath, HashCache &hashes)
+{
+	if (hashes.contains(filePath))
+		return hashes.value(filePath);
+
+	QByteArray result;
+	QFile file(filePath);
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QCryptographicHash h(QCryptographicHash::Md5);
+		while(!file.atEnd())
+			h.addData(file.read(1024*1024));
+		result = h.result();
+	}
+	hashes.insert(filePath, result);
+	return result;
+}
+
+static const QByteArray toolHash(const QString &build, const QString &tool, const QString &version, HashCache &hashes)
+{
+	QString key = "tool:"+tool;
+	if (hashes.contains(key))
+		return hashes.value(key);
+
+	QCryptographicHash h(QCryptographicHash::Md5);
+	h.addData(version.toUtf8());
+	h.addData(tool.toUtf8());
+
+	QStringList files;
+	QDirIterator it(build+"/src/tools/"+tool, QDir::Files, QDirIterator::Subdirectories);
+	while(it.hasNext())
+		files.append(it.next());
+	files.sort();
+
+	FOR_CONST_IT(files)
+	{
+		h.addData(QDir(build).relativeFilePath(*IT).toUtf8());
+		h.addData(fileHash(*IT, hashes));
+	}
+	hashes.insert(key, h.result());
+	return hashes.value(key);
+}
+
+static const QString ruleKey(const GeneratedRule &rule, const QString &build, const QString &version, HashCache &hashes)
+{
+	QCryptographicHash h(QCryptographicHash::Sha1);
+	h.addData(toolHash(build, rule.tool, version, hashes));
+
+	QDir base(build);
+	QString native = QDir::toNativeSeparators(build);
+	QStringList args = splitTokens(rule.command);
+	for(int i = 0; i < args.count(); i++)
+	{
+		QString arg = args.at(i);
+		if (arg == "-I")
+		{
+			i++;
+			continue;
+		}
+		if (arg.startsWith("-I"))
+			continue;
+
+		arg.replace(native, "$(BUILD)", Qt::CaseInsensitive);
+		arg.replace(build,	"$(BUILD)", Qt::CaseInsensitive);
+		h.addData(arg.toUtf8());
+	}
+
+	h.addData(base.relativeFilePath(rule.target).toUtf8());
+	FOR_CONST_IT(rule.depends)
+	{
+		QByteArray hash = fileHash(*IT, hashes);
+		if (hash.isEmpty()) // ... not a file (yet), thus nothing to rely on.
+			return QString();
+
+		h.addData(base.relativeFilePath(*IT).toUtf8());
+		h.addData(hash);
+	}
+	return h.result().toHex();
+}
+
+static const QString cacheFile(const QString &root, const QString &key)
+{
+	return root+SLASH+key.left(2)+SLASH+key.mid(2)+".gen";
+}
+
+static bool writeFile(const QString &source, const QString &target)
+{	//
+	// note: not using QFile::copy, which keeps the file time on windows!
+	//
+	QFile in(source);
+	if (!in.open(QIODevice::ReadOnly))
+		return false;
+
+	QString dir = QFileInfo(target).absolutePath();
+	if (!QDir(dir).exists() && !QDir().mkpath(dir))
+		return false;
+
+	QFile out(target);
+	return out.open(QIODevice::WriteOnly) && out.write(in.readAll()) == in.size();
+}
+
+
+
+int GeneratedCache::seed(const QString &root, const QString &build, const QString &version)
+{
+	int count = 0;
+	HashCache hashes;
+	QList<GeneratedRule> rules = readMakefiles(build);
+	FOR_CONST_IT(rules)
+	{
+		QString key = ruleKey(*IT, build, version, hashes);
+		if (key.isEmpty() || QFile::exists((*IT).target))
+			continue;
+
+		QString cached = cacheFile(root, key);
+		if (QFile::exists(cached) && writeFile(cached, (*IT).target))
+		{
+			touchFile(cached);
+			count++;
+		}
+	}
+	return count;
+}
+
+int GeneratedCache::store(const QString &root, const QString &build, const QString &version)
+{
+	int count = 0;
+	HashCache hashes;
+	QList<GeneratedRule> rules = readMakefiles(build);
+	FOR_CONST_IT(rules)
+	{
+		if (!QFile::exists((*IT).target))
+			continue;
+
+		QString key = ruleKey(*IT, build, version, hashes);
+		QString cached = cacheFile(root, key);
+		if (key.isEmpty() || QFile::exists(cached))
+			continue;
+
+		QString temp = QString("%1.%2.tmp").arg(cached).arg(qHash(QThread::currentThread()));
+		if (writeFile((*IT).target, temp) && QFile::rename(temp, cached))
+			count++;
+		else
+			QFile::remove(temp);
+	}
+	return count;
+}
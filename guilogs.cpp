@@ -28,14 +28,23 @@
 #include <QPainter>
 #include <QDateTime>
 #include <QTimer>
-
-const QString qtBuilderTableBody("<html><header><style>TD{padding:0px 6px;}</style></header><body style=font-size:11pt;font-family:Calibri;><table>");
-const QString qtBuilderTableLine("<tr><td style=font-size:10pt>%1</td><td><b style=color:%2>%3</b></td><td>%4</td></tr>");
-const QString qtBuilderTableHtml("</table><a name=\"end\"><br/></body></html>");
+#include <QScrollBar>
+#include <QTextTable>
+#include <QDataStream>
+#include <QClipboard>
+#include <QKeyEvent>
+#include <QInputDialog>
+
+const QString qtBuilderTableTime("<span style=font-size:10pt>%1</span>");
+const QString qtBuilderTableMesg("<b style=color:%1>%2</b>");
+const QString qtBuilderTableFont("Calibri");
+const int	  qtBuilderTableRows  = 2000;	// ... rows kept in the document; older ones are read back from the spill file on scrolling up
+const int	  qtBuilderTableChunk = 200;	// ... rows read back at once
 const QString qtBuilderLogLine("%1\t%2\t%3%4\r\n");
 const QString qtBuilderBuildLogTabs = QString(___LF)+QString(__TAB).repeated(9);
 
-QtAppLog::QtAppLog(QWidget *parent) : QTextBrowser(parent)
+QtAppLog::QtAppLog(QWidget *parent) : QTextBrowser(parent),
+	m_table(NULL), m_first(0)
 {
 	setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 	setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
@@ -44,12 +53,18 @@ QtAppLog::QtAppLog(QWidget *parent) : QTextBrowser(parent)
 	setFocusPolicy(Qt::NoFocus);
 	setMinimumWidth(640);
 
+	QFont font(qtBuilderTableFont);
+	font.setPointSize(11);
+	document()->setDefaultFont(font);
+
 	m_info.insert(AppInfo,	"AppInfo ");
 	m_info.insert(Process,	"Process ");
 	m_info.insert(Warning,	"Warning ");
 	m_info.insert(Informal,	"Informal");
 	m_info.insert(Elevated,	"Elevated");
 	m_info.insert(Critical,	"Critical");
+
+	connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(scrolled(int)));
 }
 
 const QString QtAppLog::logFile()
@@ -87,9 +102,7 @@ const QString QtAppLog::clean(QString text, bool extended)
 
 void QtAppLog::addSeparator()
 {
-	QFile log(logFile());
-	if (log.open(QIODevice::Append))
-		log.write(QString("\r\n%1\r\n").arg(QString("*").repeated(120)).toUtf8().constData());
+	LogWriter::instance()->write(logFile(), QString("\r\n%1\r\n").arg(QString("*").repeated(120)).toUtf8());
 }
 
 void QtAppLog::add(const QString &msg, int type)
@@ -102,40 +115,145 @@ void QtAppLog::add(const QString &msg, const QString &text, int type)
 	QString ts = QDateTime::currentDateTime().toString(Qt::ISODate);
 	QString message = msg;
 	ts.replace("T", ", ");
+	//
+	// rows are only ever appended; duplicates (i.e. process messages posted to stdout AND
+	// stdErr) are filtered by their hash, all rows go to the spill file for scrolling back.
+	// duplicates share the time stamp, thus only the hashes of the latest rows are kept.
+	//
+	uint hash = qHash(ts+QChar(type)+msg+QChar(0)+text);
+	if (!m_hashes.contains(hash))
+	{
+		m_hashes.insert(hash);
+		m_hashOrder.enqueue(hash);
+		if (m_hashOrder.count() > qtBuilderTableRows)
+			m_hashes.remove(m_hashOrder.dequeue());
 
-	m_timestamp.append(ts);
-	m_message.append(message);
-	m_description.append(text);
-	m_type.append(type);
+		spill(ts, type, msg, text); // ... if this fails, the row is just not read back on scrolling up.
 
-	QSet<uint> hashes;
-	QString tline;
+		QScrollBar *bar = verticalScrollBar();
+		bool bottom = bar->value() == bar->maximum();
 
-	QString h = qtBuilderTableBody;
-	int count = m_type.count();
-	for(int i = 0; i < count; i++)
-	{
-		tline = qtBuilderTableLine.arg(m_timestamp.at(i), colors.at(m_type.at(i)), m_message.at(i), m_description.at(i));
-		uint hash = qHash(tline); // ... filter out duplicates for process messages posted to stdout AND stdErr!!!
-
-		if (!hashes.contains(hash))
-		{	 hashes.insert(hash);
-			 h.append(tline);
+		insertRow(-1, ts, type, msg, text);
+		if (bottom)
+		{
+			trimRows();
+			bar->setValue(bar->maximum());
 		}
 	}
-	h.append(qtBuilderTableHtml);
-
-	setText(h);
-	scrollToAnchor("end");
 
 	if (type == Process)
 		if (int len = qMax(0, 30-msg.length()))
 			message += QString(" %1 ").arg(QString("*").repeated(len));
 
-	QFile log(logFile());
-	if (log.open(QIODevice::Append))
-		log.write(qtBuilderLogLine.arg(ts, m_info.value(type), message.leftJustified(32),
-			QString(text).replace(___LF, qtBuilderBuildLogTabs)).toUtf8().constData());
+	LogWriter::instance()->write(logFile(), qtBuilderLogLine.arg(ts, m_info.value(type), message.leftJustified(32),
+		QString(text).replace(___LF, qtBuilderBuildLogTabs)).toUtf8());
+}
+
+bool QtAppLog::spill(const QString &ts, int type, const QString &msg, const QString &text)
+{	//
+	// every row gets an index entry (to stay in line with the table rows); -1 if not spilled.
+	//
+	m_index.append(-1);
+	if (!m_spill.isOpen())
+	{
+		m_spill.setFileTemplate(QDir::tempPath()+"/qtbuilder-XXXXXX.rows");
+		if (!m_spill.open())
+			return false;
+	}
+	qint64 pos = m_spill.size();
+	if (!m_spill.seek(pos))
+		return false;
+
+	QDataStream s(&m_spill);
+	s << ts << (qint32)type << msg << text;
+	if (s.status() != QDataStream::Ok)
+		return false;
+
+	m_index.last() = pos;
+	return true;
+}
+
+bool QtAppLog::readRow(int index, QString &ts, int &type, QString &msg, QString &text)
+{
+	if (index < 0 || index >= m_index.count() || m_index.at(index) < 0 || !m_spill.seek(m_index.at(index)))
+		return false;
+
+	qint32 t;
+	QDataStream s(&m_spill);
+	s >> ts >> t >> msg >> text;
+	type = t;
+	return s.status() == QDataStream::Ok;
+}
+
+void QtAppLog::insertRow(int at, const QString &ts, int type, const QString &msg, const QString &text)
+{
+	if (!m_table)
+	{
+		QTextTableFormat f;
+		f.setBorder(0);
+		f.setCellSpacing(0);
+		f.setCellPadding(0);
+
+		QTextCursor c(document());
+		c.movePosition(QTextCursor::End);
+		m_table = c.insertTable(1, 3, f);
+		at = 0;
+	}
+	else if (at < 0)
+	{
+		at = m_table->rows();
+		m_table->appendRows(1);
+	}
+	else m_table->insertRows(at, 1);
+
+	QStringList cells = QStringList()
+		<< qtBuilderTableTime.arg(ts)
+		<< qtBuilderTableMesg.arg(colors.at(type), msg)
+		<< text;
+
+	for(int i = 0; i < cells.count(); i++)
+	{
+		QTextTableCell cell = m_table->cellAt(at, i);
+		QTextTableCellFormat f = cell.format().toTableCellFormat();
+		f.setLeftPadding (6);
+		f.setRightPadding(6);
+		cell.setFormat(f);
+
+		QTextCursor c = cell.firstCursorPosition();
+		c.insertHtml(cells.at(i));
+	}
+}
+
+void QtAppLog::trimRows()
+{
+	int rows = m_table ? m_table->rows() : 0;
+	if (rows <= qtBuilderTableRows)
+		return;
+
+	m_table->removeRows(0, rows-qtBuilderTableRows);
+	m_first += rows-qtBuilderTableRows;
+}
+
+void QtAppLog::scrolled(int value)
+{	//
+	// older rows are read back from the spill file in chunks when scrolled to the top;
+	// the view keeps its position, they are dropped again once it's back at the bottom.
+	//
+	QScrollBar *bar = verticalScrollBar();
+	if (value != bar->minimum() || !m_first || !m_table)
+		return;
+
+	int from = qMax(0, m_first-qtBuilderTableChunk);
+	int height = bar->maximum();
+
+	QString ts, msg, text;
+	int type;
+	for(int i = m_first-1; i >= from; i--)
+		if (readRow(i, ts, type, msg, text))
+			insertRow(0, ts, type, msg, text);
+
+	m_first = from;
+	bar->setValue(bar->maximum()-height);
 }
 
 void QtAppLog::paintEvent(QPaintEvent *event)
@@ -160,30 +278,62 @@ void QtAppLog::paintEvent(QPaintEvent *event)
 }
 
 
-const bool	  qtBuilderWriteBldLog = true;	// creates a build.log with all the stdout from configure/jom; is copied to the target folder.
-const QString qtBuilderCommandStyle("QTextEdit { border: none; color: white; background: #181818; } QTextEdit:disabled { background: #323232; color: #969696; }");
-
-BuildLog::BuildLog(QWidget *parent) : QTextEdit(parent),
-	m_lineCount(0)
+const bool	  qtBuilderWriteBldLog = true;	// creates a build log with all the stdout from configure/jom (compressed, see FramedLog); is copied to the target folder.
+const int	  qtBuilderViewLines = 20000;	// ... lines kept in memory; older ones are read back from the build log file on scrolling up
+const int	  qtBuilderViewChunk = 256;		// ... lines read back at once
+const int	  qtBuilderViewFrame = 40;		// ... ms; appended output is painted at most this often
+const QColor  qtBuilderViewBack	 ("#181818");
+const QColor  qtBuilderViewText	 (Qt::white);
+const QColor  qtBuilderViewBackOff("#323232");
+const QColor  qtBuilderViewTextOff("#969696");
+const QColor  qtBuilderViewSelect("#3A5F8C");
+//
+// a terminal style view: the last lines are kept in a ring and only the visible ones are painted;
+// appending just marks the view as dirty, the repaint follows on the next frame. with the output
+// of a single build folder the lines that dropped out of the ring come from the build log file.
+//
+BuildLog::BuildLog(QWidget *parent) : QAbstractScrollArea(parent),
+	m_ring(qtBuilderViewLines), m_total(0), m_fileLines(0), m_readerBase(-1), m_chunkFrom(-1),
+	m_reopened(false), m_selFrom(-1), m_selTo(-1), m_lineCount(0)
 {
-	setTextInteractionFlags(Qt::TextSelectableByMouse|Qt::TextSelectableByKeyboard);
 	setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 	setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 	setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-	setStyleSheet(qtBuilderCommandStyle);
-	setLineWrapMode(QTextEdit::NoWrap);
 	setFrameStyle(QFrame::NoFrame);
-	setFontFamily("Consolas");
+	setFocusPolicy(Qt::StrongFocus);
 	setMinimumWidth(960);
-	setFontPointSize(9);
+
+	QFont font("Consolas");
+	font.setPointSize(9);
+	font.setStyleHint(QFont::TypeWriter);
+	setFont(font);
+
+	m_frame.setSingleShot(true);
+	connect(&m_frame, SIGNAL(timeout()), this, SLOT(refresh()));
 	setFocus();
 }
 
 const QString BuildLog::logFile()
 {
-	if (	m_logFile.isEmpty())
-			m_logFile = SLASH+qApp->applicationName()+".log";
-	return	m_logFile;
+	return SLASH+qApp->applicationName()+".log.qz";
+}
+
+void BuildLog::clear()
+{
+	m_total = m_fileLines = 0;
+	m_selFrom = m_selTo = -1;
+	m_viewOnly.clear();
+	m_held.clear();
+	m_paths.clear();
+	m_path.clear();
+	invalidate();
+	refresh();
+}
+
+void BuildLog::mark(const QString &label, const QString &path)
+{
+	if (qtBuilderWriteBldLog)
+		LogWriter::instance()->mark(path+logFile(), label);
 }
 
 void BuildLog::append(const QString &text, const QString &path)
@@ -191,52 +341,290 @@ void BuildLog::append(const QString &text, const QString &path)
 	if (text.simplified().trimmed().isEmpty())
 		return;
 
-	if (!m_lineCount)
-		QTextEdit::append(text.trimmed());
+	//
+	// the view shows the same lines as the file (plus the view-only banners); output arriving
+	// while a banner is shown is held back and added after it.
+	//
+	QStringList lines = text.trimmed().split(___LF);
+	FOR_CONST_IT(lines)
+		if (m_lineCount)
+			 m_held.append(QString(*IT).remove('\r'));
+		else addLine(QString(*IT).remove('\r'));
+
+	m_fileLines += lines.count();
+	if (!m_paths.contains(path))
+	{	m_paths.insert(path);
+		m_path = path;
+	}
 
 	if (!qtBuilderWriteBldLog)
 		return;
 
-	QFile log(path+logFile());
-	if (log.open(QIODevice::Append))
-		log.write(text.toUtf8().constData());
+	LogWriter::instance()->writeFramed(path+logFile(), text.trimmed().toUtf8()+"\n"); // ... one line per chunk, as shown.
+}
+
+void BuildLog::addLine(const QString &line, bool viewOnly)
+{
+	if (viewOnly)
+		m_viewOnly.append(m_total);
+
+	m_ring[m_total++ % qtBuilderViewLines] = line;
+	if (!m_frame.isActive())
+		m_frame.start(qtBuilderViewFrame);
+}
+
+void BuildLog::refresh()
+{
+	QScrollBar *bar = verticalScrollBar();
+	bool follow = bar->value() == bar->maximum();
+
+	bar->setRange(0, qMax(0, int(m_total)-visibleLines()+1));
+	bar->setPageStep(visibleLines());
+	if (follow)
+		bar->setValue(bar->maximum());
+
+	viewport()->update();
+}
+
+int BuildLog::visibleLines() const
+{
+	return qMax(1, viewport()->height()/fontMetrics().lineSpacing());
+}
+
+void BuildLog::invalidate()
+{
+	m_readerBase = -1;
+	m_chunkFrom = -1;
+	m_chunk.clear();
+}
+
+void BuildLog::release()
+{
+	FOR_CONST_IT(m_held)
+		addLine(*IT);
+	m_held.clear();
+}
+
+qint64 BuildLog::fileLine(qint64 index) const
+{	//
+	// the file line of a view line: the view-only (banner) lines before it are left out.
+	//
+	return m_readerBase+index-(qLowerBound(m_viewOnly.begin(), m_viewOnly.end(), index)-m_viewOnly.begin());
+}
+
+qint64 BuildLog::viewLine(qint64 fileLine) const
+{
+	qint64 index = fileLine-m_readerBase;
+	FOR_CONST_IT(m_viewOnly)
+		if (*IT <= index)
+			index++;
+	return index;
+}
+
+void BuildLog::rewind(qint64 first)
+{	//
+	// scrolled back past the lines in memory: the pending output is flushed once here (not on
+	// painting); all lines appended so far are in the file then, the view's first line thus
+	// is the file's line count minus the lines appended since.
+	//
+	if (first >= m_total-qtBuilderViewLines || m_paths.count() != 1 || !qtBuilderWriteBldLog)
+		return;
+
+	LogWriter::instance()->flush();
+	if (!m_reader.open(m_path+logFile()))
+		return;
+
+	if (m_readerBase < 0) // ... the lines still held back are in the file, but not in the view yet.
+		m_readerBase = m_reader.lines()-m_fileLines;
+}
+
+const QString BuildLog::line(qint64 index)
+{
+	if (index < 0 || index >= m_total)
+		return QString();
+
+	if (index >= m_total-qtBuilderViewLines)
+		return m_ring.at(index % qtBuilderViewLines);
+
+	if (m_paths.count() != 1 || !qtBuilderWriteBldLog || m_readerBase < 0)
+		return QString(); // ... mixed output of several lanes (the files don't match the view), or not rewound yet.
+
+	if (qBinaryFind(m_viewOnly.begin(), m_viewOnly.end(), index) != m_viewOnly.end())
+		return QString(); // ... a banner line that dropped out of the ring.
+
+	qint64 at = fileLine(index); // ... the chunk is kept by file lines.
+	if (at >= m_chunkFrom && at < m_chunkFrom+m_chunk.count())
+		return m_chunk.at(at-m_chunkFrom);
+
+	if (at >= m_reader.lines())
+	{	// ... frames written since the reader was opened (once per paint, the writer flushes on its own).
+		if (m_reopened || !m_reader.open(m_path+logFile()))
+			return QString();
+		m_reopened = true;
+	}
+	m_chunkFrom = qMax((qint64)0, at-qtBuilderViewChunk/2);
+	m_chunk = m_reader.lines(m_chunkFrom, qtBuilderViewChunk);
+
+	if (at-m_chunkFrom >= m_chunk.count())
+		return QString();
+	return m_chunk.at(at-m_chunkFrom);
+}
+
+void BuildLog::paintEvent(QPaintEvent *event)
+{
+	Q_UNUSED(event);
+	m_reopened = false;
+
+	QPainter p(viewport());
+	p.fillRect(viewport()->rect(), isEnabled() ? qtBuilderViewBack : qtBuilderViewBackOff);
+	p.setFont(font());
+
+	int height = fontMetrics().lineSpacing();
+	int ascent = fontMetrics().ascent();
+	qint64 first = verticalScrollBar()->value();
+	qint64 from = qMin(m_selFrom, m_selTo), to = qMax(m_selFrom, m_selTo);
+
+	for(int i = 0; i <= visibleLines() && first+i < m_total; i++)
+	{
+		qint64 index = first+i;
+		if (from >= 0 && index >= from && index <= to)
+			p.fillRect(QRect(0, i*height, viewport()->width(), height), qtBuilderViewSelect);
+
+		p.setPen(isEnabled() ? qtBuilderViewText : qtBuilderViewTextOff);
+		p.drawText(4, i*height+ascent, line(index));
+	}
+}
+
+void BuildLog::resizeEvent(QResizeEvent *event)
+{
+	QAbstractScrollArea::resizeEvent(event);
+	refresh();
+}
+
+void BuildLog::scrollContentsBy(int dx, int dy)
+{
+	Q_UNUSED(dx);
+	Q_UNUSED(dy);
+	rewind(verticalScrollBar()->value());
+	viewport()->update();
+}
+
+void BuildLog::mousePressEvent(QMouseEvent *event)
+{
+	m_selFrom = m_selTo = qMin(m_total-1, (qint64)verticalScrollBar()->value()+event->pos().y()/fontMetrics().lineSpacing());
+	viewport()->update();
+}
+
+void BuildLog::mouseMoveEvent(QMouseEvent *event)
+{
+	if (m_selFrom < 0 || !(event->buttons() & Qt::LeftButton))
+		return;
+
+	m_selTo = qBound((qint64)0, (qint64)verticalScrollBar()->value()+event->pos().y()/fontMetrics().lineSpacing(), m_total-1);
+	viewport()->update();
+}
+
+void BuildLog::keyPressEvent(QKeyEvent *event)
+{	//
+	// selections are whole lines; copied as text.
+	//
+	if (event->matches(QKeySequence::SelectAll))
+	{
+		m_selFrom = 0;
+		m_selTo = m_total-1;
+		viewport()->update();
+	}
+	else if (event->matches(QKeySequence::Copy) && m_selFrom >= 0)
+	{
+		QStringList text;
+		rewind(qMin(m_selFrom, m_selTo));
+		for(qint64 i = qMin(m_selFrom, m_selTo); i <= qMax(m_selFrom, m_selTo); i++)
+			text.append(line(i));
+		QApplication::clipboard()->setText(text.join(_CRLF));
+	}
+	else if (event->matches(QKeySequence::Find))
+	{
+		bool ok;
+		QString text = QInputDialog::getText(this, "Find", "Find in build output:", QLineEdit::Normal, m_find, &ok);
+		if (ok && !text.isEmpty())
+			find(m_find = text);
+	}
+	else if (event->matches(QKeySequence::FindNext) && !m_find.isEmpty())
+	{
+		find(m_find);
+	}
+	else QAbstractScrollArea::keyPressEvent(event);
+}
+
+void BuildLog::find(const QString &text)
+{	//
+	// from the line after the selection (or the first one shown); where the view is backed by
+	// the build log file, the file is searched (only the frames up to the hit are unpacked).
+	//
+	qint64 from = m_selFrom >= 0 ? qMax(m_selFrom, m_selTo)+1 : verticalScrollBar()->value();
+	QRegExp rx(QRegExp::escape(text), Qt::CaseInsensitive);
+	qint64 hit = -1;
+
+	rewind(0);
+	if (m_readerBase >= 0 && m_paths.count() == 1 && qtBuilderWriteBldLog)
+	{
+		QList<LogReader::Hit> hits = m_reader.search(rx, 1, fileLine(from));
+		if (!hits.isEmpty())
+			hit = viewLine(hits.first().first);
+	}
+	for(qint64 i = qMax(from, m_total-qtBuilderViewLines); hit < 0 && i < m_total; i++)
+		if (rx.indexIn(m_ring.at(i % qtBuilderViewLines)) >= 0)
+			hit = i;
+
+	if (hit < 0 || hit >= m_total)
+	{
+		QApplication::beep();
+		return;
+	}
+	m_selFrom = m_selTo = hit;
+	verticalScrollBar()->setValue(qMax((qint64)0, hit-visibleLines()/2));
+	viewport()->update();
 }
 
 void BuildLog::endFailure()
 {
 	if (!m_lineCount)
-		QTextEdit::append(___LF+___LF);
+	{	addLine(QString(), true);
+		addLine(QString(), true);
+	}
 
 	QStringList a = QString(qUncompress(__ARR)).split(___LF);
 	if (a.count() > m_lineCount)
 	{
-		QTextEdit::append(a.at(m_lineCount++));
+		addLine(a.at(m_lineCount++), true);
 		QTimer::singleShot(50, this, SLOT(endFailure()));
 	}
 	else if (a.count() == m_lineCount)
 	{
-		QTextEdit::append(___LF);
+		addLine(QString(), true);
 		m_lineCount =  0;
+		release();
 	}
-	ensureCursorVisible();
 }
 
 void BuildLog::endSuccess()
 {
 	if (!m_lineCount)
-		QTextEdit::append(___LF+___LF);
+	{	addLine(QString(), true);
+		addLine(QString(), true);
+	}
 
 	QStringList h = QString(qUncompress(__HRR)).split(___LF);
 	if (h.count() > m_lineCount)
 	{
-		QTextEdit::append(h.at(m_lineCount++));
+		addLine(h.at(m_lineCount++), true);
 		QTimer::singleShot(50, this, SLOT(endSuccess()));
 	}
 	else if (h.count() == m_lineCount)
 	{
-		QTextEdit::append(___LF);
+		addLine(QString(), true);
 		m_lineCount =  0;
+		release();
 	}
-	ensureCursorVisible();
 }
 
@@ -80,8 +80,8 @@ void QtBuilder::createUi()
 	m_tmp = new DiskSpaceBar(wgt, Process,  "Build ");
 	m_tgt = new DiskSpaceBar(wgt, Elevated, "Target");
 
-	connect(m_qtc, SIGNAL(log(const QString &, const QString&,int)), m_log, SLOT(add(const QString &, const QString&,int)),	Qt::BlockingQueuedConnection);
-	connect(m_qtc, SIGNAL(log(const QString &, int)),				 m_log, SLOT(add(const QString &, int)),				Qt::BlockingQueuedConnection);
+	connect(m_qtc, SIGNAL(log(const QString &, const QString&,int)), m_bus, SLOT(log(const QString &, const QString&,int)),	Qt::DirectConnection);
+	connect(m_qtc, SIGNAL(log(const QString &, int)),				 m_bus, SLOT(log(const QString &, int)),				Qt::DirectConnection);
 	connect(m_qtc, SIGNAL(progress(int, const QString &, qreal)),	 m_cpy, SLOT(progress(int, const QString &, qreal)),	Qt::QueuedConnection);
 	connect(m_qtc, SIGNAL(progress(int, const QString &, qreal)),	 m_tgt, SLOT(refresh()),								Qt::QueuedConnection);
 	connect(m_qtc, SIGNAL(progress(int, const QString &, qreal)),	 m_tmp, SLOT(refresh()),								Qt::QueuedConnection);
@@ -50,6 +50,10 @@ const QRect centerRect(int percentOfScreen, int screenNbr)
 
 #ifdef _WIN32
 #include "windows.h"
+#else
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <fcntl.h>
 #endif
 bool getDiskSpace(const QString &anyPath, uint &totalMb, uint &freeMb)
 {
@@ -66,6 +70,40 @@ bool getDiskSpace(const QString &anyPath, uint &totalMb, uint &freeMb)
 		SetErrorMode(0);
 		return true;
 	}
+#else
+	struct statvfs st;
+	if (statvfs(QFile::encodeName(anyPath).constData(), &st) == 0)
+	{
+		quint64 MB = quint64(1024*1024);
+		freeMb	= (uint)((quint64(st.f_bavail) * st.f_frsize) / MB);
+		totalMb = (uint)((quint64(st.f_blocks) * st.f_frsize) / MB);
+		return true;
+	}
+#endif
+	return false;
+}
+
+bool getMemorySize(uint &totalMb, uint &freeMb)
+{
+#ifdef _WIN32
+	MEMORYSTATUSEX mem;
+	mem.dwLength = sizeof(mem);
+	if (GlobalMemoryStatusEx(&mem))
+	{
+		quint64 MB = quint64(1024*1024);
+		freeMb	= (uint)((mem.ullAvailPhys) / MB);
+		totalMb = (uint)((mem.ullTotalPhys) / MB);
+		return true;
+	}
+#else
+	QFile info("/proc/meminfo");
+	if (info.open(QIODevice::ReadOnly))
+	{
+		QString text = info.readAll();
+		totalMb = getValueFrom(text, "MemTotal:",	  "kB").trimmed().toULongLong() /1024;
+		freeMb	= getValueFrom(text, "MemAvailable:", "kB").trimmed().toULongLong() /1024;
+		return totalMb > 0;
+	}
 #endif
 	return false;
 }
@@ -132,6 +170,79 @@ bool removeSymlink(const QString &target)
 	return QFile(target).remove();
 }
 
+bool copyFileTime(const QString &source, const QString &target)
+{	//
+	// note: files written by the copy engine itself (i.e. chunked copies) need the source
+	// timestamps, otherwise the next synchronize pass would consider them to be outdated!
+	//
+#ifdef _WIN32
+	QString src = QDir::toNativeSeparators(source);
+	QString tgt = QDir::toNativeSeparators(target);
+	bool result = false;
+
+	HANDLE s = CreateFileW((LPCWSTR)src.utf16(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+	HANDLE t = CreateFileW((LPCWSTR)tgt.utf16(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+	if (s != INVALID_HANDLE_VALUE && t != INVALID_HANDLE_VALUE)
+	{
+		FILETIME c, a, w;
+		result = GetFileTime(s, &c, &a, &w) && SetFileTime(t, &c, &a, &w);
+	}
+	if (s != INVALID_HANDLE_VALUE) CloseHandle(s);
+	if (t != INVALID_HANDLE_VALUE) CloseHandle(t);
+	return result;
+#else
+	struct stat st;
+	if (stat(QFile::encodeName(source).constData(), &st))
+		return false;
+
+	struct timespec times[2];
+	times[0] = st.st_atim;
+	times[1] = st.st_mtim;
+	return !utimensat(AT_FDCWD, QFile::encodeName(target).constData(), times, 0);
+#endif
+}
+
+bool touchFile(const QString &path)
+{
+#ifdef _WIN32
+	QString nat = QDir::toNativeSeparators(path);
+	HANDLE h = CreateFileW((LPCWSTR)nat.utf16(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+	if (h == INVALID_HANDLE_VALUE)
+		return false;
+
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	bool result = SetFileTime(h, NULL, &now, &now);
+	CloseHandle(h);
+	return result;
+#else
+	return !utimensat(AT_FDCWD, QFile::encodeName(path).constData(), NULL, 0);
+#endif
+}
+
+quint64 getFileIndex(const QString &path)
+{
+#ifdef _WIN32
+	QString nat = QDir::toNativeSeparators(path);
+	HANDLE h = CreateFileW((LPCWSTR)nat.utf16(), 0, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+	if (h == INVALID_HANDLE_VALUE)
+		return 0;
+
+	BY_HANDLE_FILE_INFORMATION info;
+	quint64 index = 0;
+	if (GetFileInformationByHandle(h, &info))
+		index = (quint64(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+
+	CloseHandle(h);
+	return index;
+#else
+	struct stat st;
+	if (stat(QFile::encodeName(path).constData(), &st))
+		return 0;
+	return st.st_ino;
+#endif
+}
+
 const QString getLastWinError()
 {
 #ifdef _WIN32
@@ -47,6 +47,7 @@ const QString SETTINGS_L_TARGET("LastTargetPath");
 const QString SETTINGS_LVERSION("LastVersionNbr");
 const QString SETTINGS_BUILDOPT("LastBldOptions");
 const QString SETTINGS_GEOMETRY("WindowGeometry");
+const QString SETTINGS_COPYCOUNT("LastCopyCounts");
 
 #define FOR_CONST_IT(OBJECT)											\
 	for (auto IT = OBJECT.constBegin(); IT != OBJECT.constEnd(); ++IT)	\
@@ -139,8 +140,12 @@ template <typename T> T Map(const T &val, const T &minIn, const T &maxIn, const
 const QRect centerRect(int percentOfScreen, int screenNbr = -1);
 
 bool getDiskSpace(const QString &anyPath, uint &totalMb, uint &freeMb);
+bool getMemorySize(uint &totalMb, uint &freeMb);
 bool createSymlink(const QString &source, const QString &target, QString &error = QString());
 bool removeSymlink(const QString &target);
+bool copyFileTime(const QString &source, const QString &target);
+bool touchFile(const QString &path);
+quint64 getFileIndex(const QString &path);
 bool unmountFolder(const QString &path, QString &error = QString());
 bool mountFolder(const QString &srcDrive, const QString &tgtPath, QString &error = QString());
 const QString getValueFrom(const QString &string, const QString &inTag, const QString &outTag);
@@ -0,0 +1,292 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QDataStream>
+#ifdef _WIN32
+#include "Windows.h"
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+const quint32 qtBuilderFrameMagic	= 0x51544c46;
+const quint32 qtBuilderFrameVersion = 1;
+const int	  qtBuilderFrameSize	= 1024*1024;	// ... uncompressed bytes per frame; frames end at a line break
+const QString qtBuilderFrameIndex(".idx");
+//
+// the build log is a sequence of independently compressed frames (qCompress, thus zlib); the
+// index next to it lists each frame's offset, sizes and first line, plus the step markers
+// (the line a process' output started at), so readers only uncompress what they look at.
+// closing writes the pending lines as a (short) frame, so the file is complete when copied.
+//
+enum FrameRecord { FrameEntry = 1, MarkEntry = 2 };
+
+FramedLog::FramedLog(const QString &filePath) :
+	m_data(filePath), m_index(filePath+qtBuilderFrameIndex), m_line(0)
+{
+}
+
+FramedLog::~FramedLog()
+{
+	flush(true);
+}
+
+bool FramedLog::open()
+{	//
+	// appending to an existing log continues its line count.
+	//
+	LogReader reader;
+	if (reader.open(m_data.fileName()))
+		m_line = reader.lines();
+	else
+	{	QStringList stale = files(m_data.fileName());
+		FOR_CONST_IT(stale)
+			QFile::remove(*IT);
+	}
+
+	if (!m_data.open(QIODevice::Append) || !m_index.open(QIODevice::Append))
+		return false;
+
+	if (!m_index.size())
+	{
+		QDataStream s(&m_index);
+		s << qtBuilderFrameMagic << qtBuilderFrameVersion;
+	}
+	return true;
+}
+
+void FramedLog::write(const QByteArray &data)
+{
+	m_raw.append(data);
+	if (m_raw.size() < qtBuilderFrameSize)
+		return;
+
+	int end = m_raw.lastIndexOf('\n')+1;
+	if (end) // ... a single line longer than a frame is kept on going.
+		frame(end);
+}
+
+void FramedLog::mark(const QString &label)
+{
+	QDataStream s(&m_index);
+	s << (quint8)MarkEntry << (qint64)(m_line+m_raw.count('\n')) << label;
+}
+
+void FramedLog::flush(bool final)
+{	//
+	// frames end with complete lines; on the final flush a pending partial line is terminated.
+	//
+	int end = m_raw.lastIndexOf('\n')+1;
+	if (final && end < m_raw.size())
+	{
+		m_raw.append('\n');
+		end = m_raw.size();
+	}
+	if (end)
+		frame(end);
+
+	m_data.flush();
+	m_index.flush();
+}
+
+void FramedLog::sync()
+{
+	QList<QFile *> files = QList<QFile *>() << &m_data << &m_index;
+	FOR_CONST_IT(files)
+#ifdef _WIN32
+		FlushFileBuffers((HANDLE)_get_osfhandle((*IT)->handle()));
+#else
+		fsync((*IT)->handle());
+#endif
+}
+
+const QStringList FramedLog::files(const QString &filePath)
+{
+	return QStringList() << filePath << filePath+qtBuilderFrameIndex;
+}
+
+void FramedLog::frame(int length)
+{
+	QByteArray raw = m_raw.left(length);
+	QByteArray packed = qCompress(raw);
+	int lines = raw.count('\n');
+
+	qint64 offset = m_data.size();
+	if (m_data.write(packed) != packed.size())
+		return; // ... i.e. disk full; the lines stay pending.
+
+	QDataStream s(&m_index);
+	s << (quint8)FrameEntry << offset << (qint32)packed.size() << (qint32)raw.size() << m_line << (qint32)lines;
+
+	m_line += lines;
+	m_raw.remove(0, length);
+}
+
+
+
+bool LogReader::open(const QString &filePath)
+{
+	m_frames.clear();
+	m_marks.clear();
+	m_lines = 0;
+
+	m_data.close();
+	m_data.setFileName(filePath);
+
+	QFile index(filePath+qtBuilderFrameIndex);
+	if (!index.open(QIODevice::ReadOnly) || !m_data.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream s(&index);
+	quint32 magic, version;
+	s >> magic >> version;
+	if (s.status() != QDataStream::Ok || magic != qtBuilderFrameMagic || version != qtBuilderFrameVersion)
+		return false;
+
+	while(!s.atEnd())
+	{
+		quint8 kind;
+		s >> kind;
+		if (kind == FrameEntry)
+		{
+			Frame f;
+			s >> f.offset >> f.size >> f.raw >> f.line >> f.lines;
+			if (s.status() != QDataStream::Ok || f.offset+f.size > m_data.size())
+				break; // ... a frame not written completely.
+
+			m_frames.append(f);
+			m_lines = f.line+f.lines;
+		}
+		else if (kind == MarkEntry)
+		{
+			Mark m;
+			s >> m.line >> m.label;
+			if (s.status() != QDataStream::Ok)
+				break;
+			m_marks.append(m);
+		}
+		else break;
+	}
+	return true;
+}
+
+const QByteArray LogReader::frame(int index)
+{
+	if (index < 0 || index >= m_frames.count())
+		return QByteArray();
+
+	const Frame &f = m_frames.at(index);
+	if (!m_data.seek(f.offset))
+		return QByteArray();
+
+	return qUncompress(m_data.read(f.size));
+}
+
+int LogReader::frameOf(qint64 line) const
+{
+	int lo = 0, hi = m_frames.count()-1;
+	while(lo < hi)
+	{
+		int mid = (lo+hi+1)/2;
+		if (m_frames.at(mid).line <= line)
+			 lo = mid;
+		else hi = mid-1;
+	}
+	return lo;
+}
+
+const QStringList LogReader::lines(qint64 from, int count)
+{
+	QStringList result;
+	if (from < 0 || from >= m_lines)
+		return result;
+
+	for(int i = frameOf(from); i < m_frames.count() && result.count() < count; i++)
+	{
+		QList<QByteArray> l = frame(i).split('\n');
+		bool broken = l.count() <= m_frames.at(i).lines; // ... i.e. a truncated or corrupt frame; its lines are blank.
+		qint64 line = m_frames.at(i).line;
+		for(int j = 0; j < m_frames.at(i).lines && result.count() < count; j++, line++)
+			if (line >= from)
+				result.append(broken ? QString() : QString::fromUtf8(l.at(j)));
+	}
+	return result;
+}
+
+const QStringList LogReader::tail(int count)
+{
+	return lines(qMax((qint64)0, m_lines-count), count);
+}
+
+const QList<LogReader::Hit> LogReader::search(const QRegExp &rx, int maxHits, qint64 from)
+{
+	QList<Hit> hits;
+	for(int i = m_frames.isEmpty() ? 0 : frameOf(from); i < m_frames.count() && hits.count() < maxHits; i++)
+	{
+		QList<QByteArray> l = frame(i).split('\n');
+		if (l.count() <= m_frames.at(i).lines)
+			continue; // ... a truncated or corrupt frame.
+
+		qint64 line = m_frames.at(i).line;
+		for(int j = 0; j < m_frames.at(i).lines && hits.count() < maxHits; j++, line++)
+		{
+			QString text = QString::fromUtf8(l.at(j));
+			if (line >= from && rx.indexIn(text) >= 0)
+				hits.append(Hit(line, text));
+		}
+	}
+	return hits;
+}
+
+const QString LogReader::lastError()
+{	//
+	// frames are read backwards until the last error line is found; the step marker
+	// before it tells which process it came from.
+	//
+	QRegExp rx(": (fatal )?error [A-Z]*\\d+:|: error:|\\] Error \\d+", Qt::CaseInsensitive);
+	for(int i = m_frames.count()-1; i >= 0; i--)
+	{
+		QList<QByteArray> l = frame(i).split('\n');
+		if (l.count() <= m_frames.at(i).lines)
+			continue; // ... a truncated or corrupt frame.
+
+		for(int j = m_frames.at(i).lines-1; j >= 0; j--)
+		{
+			QString text = QString::fromUtf8(l.at(j)).trimmed();
+			if (rx.indexIn(text) < 0)
+				continue;
+
+			qint64 line = m_frames.at(i).line+j;
+			QString step;
+			FOR_CONST_IT(m_marks)
+				if ((*IT).line <= line)
+					step = (*IT).label;
+
+			return step.isEmpty() ? text : QString("%1\r\n(%2)").arg(text, step);
+		}
+	}
+	return QString();
+}
@@ -0,0 +1,222 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#ifdef _WIN32
+#include "Windows.h"
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+const int  qtBuilderLogBuffer = 256*1024;	// ... bytes pending before the writer is woken up
+const int  qtBuilderLogDelay  = 1000;		// ... ms; pending data is written at least this often
+const bool qtBuilderLogSync	  = false;		// ... sync the log files to disk on every flush (i.e. for unstable boxes)
+//
+// all log files are written by one thread, which keeps the files open and writes whatever was
+// collected meanwhile in one go (the build logs as compressed frames, see FramedLog); flush() waits until everything posted before was written and
+// may close the files, i.e. before a build folder with its log is moved or copied.
+//
+LogWriter *LogWriter::instance()
+{
+	static LogWriter writer;
+	return &writer;
+}
+
+LogWriter::LogWriter() : QThread(),
+	m_pendingBytes(0), m_requested(0), m_flushed(0), m_close(false), m_sync(false), m_stop(false)
+{
+	start(QThread::LowPriority);
+}
+
+LogWriter::~LogWriter()
+{
+	stop();
+}
+
+void LogWriter::write(const QString &filePath, const QByteArray &data)
+{
+	if (!data.isEmpty())
+		post(filePath, Plain, data);
+}
+
+void LogWriter::writeFramed(const QString &filePath, const QByteArray &data)
+{
+	if (!data.isEmpty())
+		post(filePath, Framed, data);
+}
+
+void LogWriter::mark(const QString &filePath, const QString &label)
+{
+	post(filePath, Marker, label.toUtf8());
+}
+
+void LogWriter::post(const QString &filePath, int kind, const QByteArray &data)
+{
+	QMutexLocker l(&m_lock);
+	if (!m_pending.contains(filePath))
+		m_order.append(filePath);
+
+	QList<QPair<int, QByteArray> > &chunks = m_pending[filePath];
+	if (!chunks.isEmpty() && chunks.last().first == kind && kind != Marker)
+		 chunks.last().second.append(data);
+	else chunks.append(qMakePair(kind, data));
+	m_pendingBytes += data.size();
+
+	if (m_pendingBytes >= qtBuilderLogBuffer)
+		m_wake.wakeOne();
+}
+
+void LogWriter::flush(bool close)
+{
+	QMutexLocker l(&m_lock);
+	if (!isRunning())
+		return;
+
+	int request = ++m_requested;
+	m_close |= close;
+	m_sync	|= qtBuilderLogSync;
+	m_wake.wakeOne();
+
+	while(m_flushed < request)
+		m_done.wait(&m_lock);
+}
+
+void LogWriter::stop()
+{
+	{	QMutexLocker l(&m_lock);
+		m_stop = true;
+		m_wake.wakeOne();
+	}
+	wait();
+}
+
+void LogWriter::run()
+{
+	forever
+	{
+		QHash<QString, QList<QPair<int, QByteArray> > > pending;
+		QStringList order;
+		bool close, sync, stop, requested;
+		int request;
+		{	QMutexLocker l(&m_lock);
+			if (!m_stop && m_requested == m_flushed && m_pendingBytes < qtBuilderLogBuffer)
+				m_wake.wait(&m_lock, qtBuilderLogDelay);
+
+			pending.swap(m_pending);
+			order.swap(m_order);
+			m_pendingBytes = 0;
+
+			request = m_requested;
+			requested = m_requested != m_flushed;
+			close	= m_close || m_stop;
+			sync	= m_sync;
+			stop	= m_stop;
+			m_close = m_sync = false;
+		}
+
+		FOR_CONST_IT(order) // ... files in the order of their first line; each file's data is in order anyway.
+		{
+			const QList<QPair<int, QByteArray> > &chunks = pending[*IT];
+			FOR_CONST_JT(chunks)
+			{
+				if ((*JT).first == Plain)
+				{
+					if (QFile *file = plainFile(*IT))
+						file->write((*JT).second);
+				}
+				else if (FramedLog *log = framedLog(*IT))
+				{
+					if ((*JT).first == Framed)
+						 log->write((*JT).second);
+					else log->mark(QString::fromUtf8((*JT).second));
+				}
+			}
+		}
+
+		FOR_CONST_IT(m_files)
+		{
+			(*IT)->flush();
+			if (sync)
+#ifdef _WIN32
+				FlushFileBuffers((HANDLE)_get_osfhandle((*IT)->handle()));
+#else
+				fsync((*IT)->handle());
+#endif
+		}
+		if (sync || requested) FOR_CONST_IT(m_frames) // ... complete lines only, a reader sees all of them then.
+		{
+			(*IT)->flush();
+			if (sync)
+				(*IT)->sync();
+		}
+		if (close)
+		{
+			qDeleteAll(m_files);
+			qDeleteAll(m_frames);
+			m_files.clear();
+			m_frames.clear();
+		}
+
+		{	QMutexLocker l(&m_lock);
+			m_flushed = request;
+			m_done.wakeAll();
+		}
+		if (stop)
+			break;
+	}
+}
+
+QFile *LogWriter::plainFile(const QString &filePath)
+{
+	QFile *file = m_files.value(filePath);
+	if (!file)
+	{
+		file = new QFile(filePath);
+		if (!file->open(QIODevice::Append))
+		{
+			delete file;
+			return NULL;
+		}
+		m_files.insert(filePath, file);
+	}
+	return file;
+}
+
+FramedLog *LogWriter::framedLog(const QString &filePath)
+{
+	FramedLog *log = m_frames.value(filePath);
+	if (!log)
+	{
+		log = new FramedLog(filePath);
+		if (!log->open())
+		{
+			delete log;
+			return NULL;
+		}
+		m_frames.insert(filePath, log);
+	}
+	return log;
+}
@@ -4,6 +4,9 @@
 
 int main(int argc, char *argv[])
 {
+	if (ObjectCache::wrapped(QString::fromLocal8Bit(argv[0])))
+		return ObjectCache::wrap(argc, argv); // ... started as compiler shim by a build.
+
 	QString app_version = QString("%1.%2.%3.%4")
 	   .arg(APP_VERSION_MAJOR)
 	   .arg(APP_VERSION_MINOR)
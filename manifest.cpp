@@ -0,0 +1,269 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QSet>
+
+const quint32 qtBuilderManifestMagic   = 0x51544d46;
+const quint32 qtBuilderManifestVersion = 1;
+const bool	  qtBuilderManifestHashes  = false;	// ... content hashes are optional; costly on a cold cache and not needed for synchronizing.
+//
+// note: the manifest trusts the directory timestamps; these change when entries get added,
+// removed or renamed, but NOT when a file is modified in place. for an installed Qt source
+// tree this is fine; after patching sources in place just delete the manifest file!
+//
+static void writeDir(QDataStream &s, const ManifestDir &dir)
+{
+	s << dir.mtime << (quint32)dir.files.count();
+	FOR_CONST_IT(dir.files)
+		s << (*IT).name << (*IT).size << (*IT).mtime << (*IT).inode << (*IT).hash;
+	s << dir.dirs;
+}
+
+static void readDir(QDataStream &s, ManifestDir &dir)
+{
+	quint32 count;
+	s >> dir.mtime >> count;
+
+	dir.files.clear();
+	for(quint32 i = 0; i < count && s.status() == QDataStream::Ok; i++)
+	{
+		ManifestFile f;
+		s >> f.name >> f.size >> f.mtime >> f.inode >> f.hash;
+		dir.files.append(f);
+	}
+	s >> dir.dirs;
+}
+
+static quint64 hashFile(const QString &path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return 0;
+
+	QCryptographicHash h(QCryptographicHash::Md5);
+	while(!file.atEnd())
+		h.addData(file.read(1024*1024));
+
+	QDataStream s(h.result());
+	quint64 hash;
+	s >> hash;
+	return hash;
+}
+
+SourceManifest::SourceManifest() :
+	m_map(NULL), m_size(0), m_scanned(0), m_reused(0)
+{
+}
+
+SourceManifest::~SourceManifest()
+{
+	clear();
+}
+
+void SourceManifest::clear()
+{
+	QMutexLocker l(&m_mutex);
+	if (m_map)
+		m_file.unmap(m_map);
+	m_file.close();
+
+	m_map  = NULL;
+	m_size = 0;
+	m_index.clear();
+	m_dirs.clear();
+	m_root.clear();
+	m_scanned = m_reused = 0;
+}
+
+bool SourceManifest::load(const QString &filePath, const QString &root)
+{	//
+	// only the folder index gets decoded here; the folder records are
+	// read from the mapped file as soon as the copy engine asks for them.
+	//
+	clear();
+	m_root = QDir::cleanPath(root);
+	m_file.setFileName(filePath);
+
+	if (!m_file.exists())
+		return false;
+
+	if (!m_file.open(QIODevice::ReadOnly) ||
+		!(m_map = m_file.map(0, m_size = m_file.size())))
+	{
+		m_file.close();
+		return false;
+	}
+
+	QByteArray data = QByteArray::fromRawData((const char *)m_map, (int)m_size);
+	QDataStream s(data);
+
+	quint32 magic, version, count;
+	QString r;
+	s >> magic >> version >> r >> count;
+
+	if (s.status() != QDataStream::Ok || magic != qtBuilderManifestMagic ||
+		version != qtBuilderManifestVersion || r != m_root)
+	{
+		clear();
+		m_root = QDir::cleanPath(root);
+		m_file.setFileName(filePath);
+		return false;
+	}
+
+	QString key;
+	quint64 offset;
+	for(quint32 i = 0; i < count && s.status() == QDataStream::Ok; i++)
+	{
+		s >> key >> offset;
+		m_index.insert(key, offset);
+	}
+
+	quint64 base = s.device()->pos();
+	FOR_IT(m_index) *IT += base;
+
+	return s.status() == QDataStream::Ok;
+}
+
+bool SourceManifest::save()
+{
+	QString filePath, root;
+	{	QMutexLocker l(&m_mutex);
+		if (!isLoaded() || m_file.fileName().isEmpty())
+			return false;
+
+		if (!m_scanned)
+		{
+			m_reused = 0;
+			return true;
+		}
+
+		filePath = m_file.fileName();
+		root	 = m_root;
+
+		QStringList keys = m_dirs.keys();
+		QByteArray index, blocks;
+		{	QDataStream b(&blocks, QIODevice::WriteOnly);
+			QDataStream i(&index,  QIODevice::WriteOnly);
+			FOR_CONST_IT(keys)
+			{	// ... folders not visited on this run (i.e. filtered ones) are dropped.
+				i << *IT << (quint64)blocks.size();
+				writeDir(b, m_dirs.value(*IT));
+			}
+		}
+
+		QFile file(filePath+".tmp");
+		if (!file.open(QIODevice::WriteOnly))
+			return false;
+
+		QDataStream s(&file);
+		s << qtBuilderManifestMagic << qtBuilderManifestVersion << m_root << (quint32)keys.count();
+		s.writeRawData(index.constData(),  index.size());
+		s.writeRawData(blocks.constData(), blocks.size());
+		file.close();
+
+		if (m_map)
+			m_file.unmap(m_map);
+		m_file.close();
+		m_map = NULL;
+
+		if ((QFile::exists(filePath) && !QFile::remove(filePath)) ||
+			!QFile::rename(filePath+".tmp", filePath))
+			return false;
+	}
+	return load(filePath, root);
+}
+
+bool SourceManifest::cached(const QString &key, ManifestDir &dir)
+{
+	if (m_dirs.contains(key))
+	{
+		dir = m_dirs.value(key);
+		return true;
+	}
+	if (!m_map || !m_index.contains(key))
+		return false;
+
+	QByteArray data = QByteArray::fromRawData((const char *)m_map, (int)m_size);
+	QDataStream s(data);
+	s.device()->seek(m_index.value(key));
+	readDir(s, dir);
+	return s.status() == QDataStream::Ok;
+}
+
+bool SourceManifest::listing(const QString &dirPath, ManifestDir &dir)
+{
+	QString key = dirPath.mid(m_root.length());
+	qint64 mtime = QFileInfo(dirPath).lastModified().toMSecsSinceEpoch();
+	{
+		QMutexLocker l(&m_mutex);
+		if (cached(key, dir) && dir.mtime == mtime)
+		{
+			if (!m_dirs.contains(key))
+				m_dirs.insert(key, dir);
+			m_reused++;
+			return true;
+		}
+	}
+	if (!scan(dirPath, dir, true))
+		return false;
+
+	QMutexLocker l(&m_mutex);
+	m_dirs.insert(key, dir);
+	m_scanned++;
+	return true;
+}
+
+bool SourceManifest::scan(const QString &dirPath, ManifestDir &dir, bool identify)
+{
+	QDir d(dirPath);
+	if (!d.exists())
+		return false;
+
+	dir = ManifestDir();
+	dir.mtime = QFileInfo(dirPath).lastModified().toMSecsSinceEpoch();
+
+	QFileInfoList infos = d.entryInfoList(QDir::Files);
+	FOR_CONST_IT(infos)
+	{
+		ManifestFile f;
+		f.name	= (*IT).fileName();
+		f.size	= (*IT).size();
+		f.mtime = (*IT).lastModified().toMSecsSinceEpoch();
+
+		if (identify)
+		{
+			f.inode = getFileIndex((*IT).absoluteFilePath());
+			if (qtBuilderManifestHashes)
+				f.hash = hashFile((*IT).absoluteFilePath());
+		}
+		dir.files.append(f);
+	}
+	dir.dirs = d.entryList(QDir::AllDirs|QDir::NoDotAndDotDot);
+	return true;
+}
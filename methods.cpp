@@ -27,9 +27,6 @@
 #include <QQueue>
 #include <QDateTime>
 #include <QDirIterator>
-#include <QThreadPool>
-
-const QString qtBuilderStaticDrive = "";//Y";	// ... use an existing drive letter; the ram disk part is skipped when set to anything else but ""; left-over build garbage will not get removed!
 
 void QtCompile::clearPath(const QString &dirPath)
 {
@@ -73,202 +70,40 @@ bool QtCompile::removeDir(const QString &dirPath, const QStringList &inc)
 
 int QtCompile::copyFolder(int fr, int to, bool synchronize, bool skipRootFiles)
 {
-	int count;
 	QString source, target;
 	if (!checkDir(to, target) ||
-		!checkDir(fr, source, count, skipRootFiles))
+		!checkDir(fr, source))
 		return 0;
-
+	//
+	// no counting pass ahead; the progress maximum is the file count of the last
+	// run (if any), which gets corrected by the copy engine while it is scanning.
+	//
+	QString key = QString("%1/%2-%3").arg(SETTINGS_COPYCOUNT).arg(to).arg(qHash(source));
+	int count = Q_SET_GET(key, 0).toInt();
 	diskOp(to, true, count);
-	count = 0;
-
-	QQueue<QPair<QDir, QDir> > queue;
-	queue.enqueue(qMakePair(QDir(source), QDir(target)));
-	bool filter =!m_extFilter.isEmpty();
-
-	QFileInfoList sinfo, dinfo;
-	QPair<QDir, QDir>  pair;
-	QString tgt, destd, nat, nme;
-	QStringList compare;
-	QDir srcDir, desDir;
-	QFileInfo src, des;
 
-	qreal  mb = 0;
-	int level = 0;
+	SourceManifest *manifest = fr == Source && m_manifest.isLoaded() ? &m_manifest : NULL;
+	CopyEngine engine(this, synchronize, skipRootFiles, manifest);
+	count = engine.run(to, source, target, count);
 
-	start();
-
-	while(!queue.isEmpty())
+	diskOp();
+	if (count && !cancelled())
 	{
-		if (cancelled())
-			goto end;
-
-		level--;
-		pair = queue.dequeue();
-		srcDir = pair.first;
-		desDir = pair.second;
-
-		if (filterDir(srcDir.absolutePath(), level >= 0))
-		{
-			if (synchronize && desDir.exists() &&
-			   !removeDir(desDir.absolutePath()))
-			{
-				log("Synchronize faild; couldn't remove:",
-					QDir::toNativeSeparators(desDir.absolutePath()), Elevated);
-				goto error;
-			}
-			continue;
-		}
-
-		if(!desDir.exists() && !QDir().mkpath(desDir.absolutePath()))
-			goto error;
-
-		destd = desDir.absolutePath()+SLASH;
-		sinfo = srcDir.entryInfoList(QDir::Files);
-
-		if (skipRootFiles)
-		{	skipRootFiles = false;
-		}
-		else FOR_CONST_IT(sinfo)
-		{
-			if (cancelled())
-				goto end;
-
-			src = *IT;
-			nme = src.fileName();
-			tgt = destd+nme;
-			des = QFileInfo(tgt);
-			nat = QDir::toNativeSeparators(tgt);
-
-			if (filter && filterExt(src))
-				continue;
-
-			if (tgt.length() > 256)
-			{
-				log("Path length exceeded", nat, Elevated);
-				goto error;
-			}
-			{	count++;
-				mb +=src.size()/MBYTE;
-				quint64 e = elapsed();
-
-				if (e && !((e)%15))
-					emit progress(count, nat, mb*1000/e);
-			}
-
-			bool exists;
-			if ((exists  = des.exists()) &&
-				des.size() == src.size() &&
-				des.lastModified() == src.lastModified())
-			{
-				if (synchronize)
-					compare.append(nme);
-				continue;
-			}
-			else if (exists && !QFile(tgt).remove())
-			{
-				log("Couldn't replace old file:", nat, Elevated);
-				goto error;
-			}
-			else if (!QFile::copy(src.absoluteFilePath(), tgt))
-			{
-				log("Couldn't copy new file:", nat, Elevated);
-				goto error;
-			}
-			else if (synchronize)
-			{
-				compare.append(nme);
-			}
-		}
-
-		if (synchronize)
-		{
-			dinfo = desDir.entryInfoList(QDir::Files);
-			FOR_CONST_IT(dinfo)
-			{
-				if (cancelled())
-					goto end;
-
-				des = *IT;
-				if (!compare.contains(des.fileName()) &&
-					!QFile(des.absoluteFilePath()).remove())
-				{
-					log("Synchronize failed; couldn't remove:",
-						QDir::toNativeSeparators(des.absoluteFilePath()), Elevated);
-					goto error;
-				}
-			}
-			compare.clear();
-		}
-
-		sinfo = srcDir.entryInfoList(QDir::AllDirs | QDir::NoDotAndDotDot);
-		destd = desDir.absolutePath()+SLASH;
-
-		FOR_CONST_IT(sinfo)
-		{
-			if (cancelled())
-				goto end;
-
-			srcDir = (*IT).absoluteFilePath();
-			nme = srcDir.dirName();
-			queue.enqueue(qMakePair(srcDir, QDir(destd+nme)));
-
-			if (synchronize)
-				compare.append(nme);
-		}
-		if (level == -1)
-			level  = sinfo.count();
-		if (level ==  0)
-			level  = -1;
-
-		if (synchronize)
-		{
-			dinfo = desDir.entryInfoList(QDir::AllDirs | QDir::NoDotAndDotDot);
-			FOR_CONST_IT(dinfo)
-			{
-				if (cancelled())
-					goto end;
-
-				des = *IT;
-				if (!compare.contains(des.fileName()) &&
-					!removeDir(des.absoluteFilePath()))
-				{
-					log("Synchronize failed; couldn't remove:",
-						QDir::toNativeSeparators(des.absoluteFilePath()), Elevated);
-					goto error;
-				}
-			}
-		}
+		Q_SET_SET(key, engine.scanned());
+		log("Copy throughput:", engine.summary());
+		log("Copy methods:", engine.backend().summary());
 	}
-
-	goto end;
-	error:
-	count=0;
-	end:
-	diskOp();
 	return count;
 }
 
-bool QtCompile::filterDir(const QString &dirPath, bool isRoot)
+bool QtCompile::filterDir(const QString &dirPath, bool isRoot) const
 {
-	bool skip = false;
-	FOR_CONST_IT(m_dirFilter)
-	{
-		if (!isRoot && (*IT).startsWith(SLASH))
-		{
-		//	qDebug()<<dirPath;
-			continue;
-		}
-
-		if ((skip = dirPath.endsWith(*IT)))
-			break;
-	}
-	return	skip;
+	return m_filter.matchDir(dirPath, isRoot);
 }
 
-bool QtCompile::filterExt(const QFileInfo &info)
+bool QtCompile::filterExt(const QString &fileName) const
 {
-	return m_extFilter.contains(info.suffix().toLower());
+	return m_filter.matchExt(fileName);
 }
 
 bool QtCompile::checkDir(int which)
@@ -311,107 +146,6 @@ bool QtCompile::checkDir(int which, QString &path)
 	return	result != Critical;
 }
 
-bool QtCompile::checkDir(int which, QString &path, int &count, bool skipRootFiles)
-{
-	count = 0;
-	if (!checkDir(which, path))
-		return false;
-
-	QQueue<QDir> queue;
-	queue.enqueue(QDir(path));
-	bool filter =!m_extFilter.isEmpty();
-
-	QFileInfoList files, dirs;
-	int level = 0;
-	QDir  dir;
-
-	while(!queue.isEmpty())
-	{
-		level--;
-		dir = queue.dequeue();
-		if (filterDir(dir.absolutePath(), level >= 0))
-			continue;
-
-		files = dir.entryInfoList(QDir::Files);
-
-		if (skipRootFiles)
-			skipRootFiles = false;
-
-		else FOR_CONST_IT(files)
-			if (!filter || !filterExt(*IT))
-				count++;
-
-		dirs = dir.entryInfoList(QDir::AllDirs|QDir::NoDotAndDotDot);
-		FOR_CONST_IT(dirs)
-			queue.enqueue(QDir((*IT).absoluteFilePath()));
-
-		if (level == -1)
-			level  = dirs.count();
-		if (level ==  0)
-			level  = -1;
-	}
-	return count;
-}
-
-bool QtCompile::attachImdisk(QString &letter)
-{
-	if (!qtBuilderStaticDrive.isEmpty())
-	{
-		letter = qtBuilderStaticDrive;
-		m_keepDisk = true;
-		return true;
-	}
-
-	QString out;
-	{	InlineProcess p(this, "imdisk.exe", "-l -n", true);
-		out = p.stdOut();
-	}
-	if (out.contains(QString::number(m_imdiskUnit)))
-	{
-		InlineProcess p(this, "imdisk.exe", QString("-l -u %1").arg(m_imdiskUnit), true);
-		QString inf = p.stdOut();
-		if (inf.contains(imdiskDrive))
-		{	//
-			// TODO: in this case it would also be needed to extend the disk if needed
-			//
-			letter	 = getValueFrom(inf, imdiskDrive, ___LF);
-			int size = getValueFrom(inf, imdiskSizeS, " ").toULongLong() /1024 /1024 /1024;
-			log("Using existing RAM disk", QString("Drive letter %1, %2GB").arg(letter).arg(size));
-
-			m_keepDisk = true;
-			return true;
-		}
-		else while(out.contains(QString::number(m_imdiskUnit)))
-		{
-			m_imdiskUnit++;
-		}
-	}
-
-	int size = m_bopts.value(RamDisk);
-	log("Trying to attach RAM disk", QString("Drive letter %1, %2GB").arg(letter).arg(size));
-
-	QString args = QString("-a -m %1: -u %2 -s %3G -o rem -p \"/fs:ntfs /q /y\"");
-	args  = args.arg(letter).arg(m_imdiskUnit).arg(size);
-
-	InlineProcess p(this, "imdisk.exe", args, false);
-	return p.normalExit();
-}
-
-bool QtCompile::removeImdisk(bool silent, bool force)
-{
-	if (m_keepDisk)
-		return true;
-
-	if (!silent)
-		log("Trying to remove RAM disk");
-
-	QString args = QString("-%1 -u %2");
-	args  = args.arg(force ? "D" : "d").arg(m_imdiskUnit);
-
-	InlineProcess p(this, "imdisk.exe", args, silent);
-	return p.normalExit();
-}
-
 const QString QtCompile::targetDir(int msvc, int arch, int type, QString &native, QStringList &t)
 {	//
 	//	USER_SET_LIB_PATH	...	something like				"D:\3d-Party\Qt"
@@ -431,21 +165,3 @@ const QString QtCompile::targetDir(int msvc, int arch, int type, QString &native
 			native = QDir::toNativeSeparators(target);
 	return	target;
 }
-
-const QString QtCompile::driveLetter()
-{
-	QFileInfoList drives = QDir::drives();
-	QStringList aToZ;
-
-	int a = (int)QChar('A').toLatin1();
-	int z = (int)QChar('Z').toLatin1();
-	for(int i = a; i <= z; i++)
-		aToZ.append(QChar::fromLatin1(i));
-
-	FOR_CONST_IT(drives)
-		aToZ.removeOne((*IT).absolutePath().left(1).toUpper());
-	if (aToZ.isEmpty())
-		return QString();
-
-	return aToZ.last();
-}
@@ -0,0 +1,534 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QTextStream>
+//
+// the build environment puts a folder with "compilers" in front of the path, which are in
+// fact QtBuilder itself (a copy on windows, symlinks elsewhere); started under such a name
+// the object is looked up by a hash of the compiler identity, the flags that matter after
+// preprocessing and the preprocessed source itself. line markers are dropped from the hash,
+// so the same translation unit hits across variant folders too; include paths and defines
+// are covered by the preprocessed output and are not hashed as flags (what ccache does).
+//
+// anything that is not a plain compile (i.e. pdb or pch handling, dependency output, ...)
+// is passed through untouched; cl /MP batches with several sources are handled per file.
+//
+const QString qtBuilderCcShim ("QTBUILDER_CC_SHIM");
+const QString qtBuilderCcCache("QTBUILDER_CC_CACHE");
+const QString qtBuilderCcStats("QTBUILDER_CC_STATS");
+
+#ifdef _WIN32
+const QStringList qtBuilderCcNames = QStringList() << "cl";
+const QChar qtBuilderPathSep(';');
+#else
+const QStringList qtBuilderCcNames = QStringList() << "cc" << "c++" << "gcc" << "g++" << "clang" << "clang++";
+const QChar qtBuilderPathSep(':');
+#endif
+const QStringList qtBuilderCcSources = QStringList() << "c" << "cc" << "cpp" << "cxx" << "c++";
+const QStringList qtBuilderClNoCache = QStringList() << "e" << "ep" << "p" << "zi";	// ... exact
+const QStringList qtBuilderClNoCachePrefix = QStringList() << "Yc" << "Yu" << "FR" << "Fr" << "FA" << "Fa" << "doc" << "analyze" << "showIncludes";
+const QStringList qtBuilderGccNoCache = QStringList() << "-E" << "-M" << "-MM" << "-MD" << "-MMD" << "-MF" << "-save-temps" << "-";
+
+struct CompileJob
+{
+	CompileJob() : cacheable(true), cl(false) {}
+
+	bool cacheable;
+	bool cl;
+	QStringList flags;		// ... hashed
+	QStringList preprocess;	// ... flags incl. include paths and defines
+	QStringList sources;
+	QStringList objects;
+};
+
+static QStringList splitArgs(const QString &line)
+{
+	QStringList args;
+	QString arg;
+	bool quoted = false, any = false;
+	for(int i = 0; i < line.length(); i++)
+	{
+		QChar c = line.at(i);
+		if (c == '"')
+		{
+			quoted = !quoted;
+			any = true;
+		}
+		else if (c.isSpace() && !quoted)
+		{
+			if (any || !arg.isEmpty())
+				args.append(arg);
+			arg.clear();
+			any = false;
+		}
+		else arg += c;
+	}
+	if (any || !arg.isEmpty())
+		args.append(arg);
+	return args;
+}
+
+static QStringList expandArgs(const QStringList &args)
+{	//
+	// response files (jom/nmake inline files, "@<<") are read, but not deleted here.
+	//
+	QStringList result;
+	FOR_CONST_IT(args)
+	{
+		if (!(*IT).startsWith('@'))
+		{
+			result.append(*IT);
+			continue;
+		}
+		QFile rsp((*IT).mid(1));
+		if (rsp.open(QIODevice::ReadOnly))
+			 result += splitArgs(QString::fromLocal8Bit(rsp.readAll()));
+		else result.append(*IT);
+	}
+	return result;
+}
+
+static const QString realCompiler(const QString &name)
+{
+	QString shim = QDir::cleanPath(QString::fromLocal8Bit(qgetenv(qtBuilderCcShim.toLatin1())));
+	QStringList path = QString::fromLocal8Bit(qgetenv("PATH")).split(qtBuilderPathSep, QString::SkipEmptyParts);
+	FOR_CONST_IT(path)
+	{
+		QString dir = QDir::cleanPath(*IT);
+#ifdef _WIN32
+		if (!dir.compare(shim, Qt::CaseInsensitive))
+			continue;
+		QFileInfo exe(dir+SLASH+name+".exe");
+#else
+		if (dir == shim)
+			continue;
+		QFileInfo exe(dir+SLASH+name);
+#endif
+		if (exe.exists() && exe.isExecutable() && exe.canonicalFilePath() != QFileInfo(QCoreApplication::applicationFilePath()).canonicalFilePath())
+			return exe.absoluteFilePath();
+	}
+	return QString();
+}
+
+static bool isSource(const QString &arg)
+{
+	return qtBuilderCcSources.contains(QFileInfo(arg).suffix().toLower());
+}
+
+static CompileJob parseCl(const QStringList &args)
+{
+	CompileJob job;
+	job.cl = true;
+
+	bool compile = false;
+	QString output;
+	for(int i = 0; i < args.count(); i++)
+	{
+		QString arg = args.at(i);
+		bool flag = arg.startsWith('/') || arg.startsWith('-');
+		QString opt = flag ? arg.mid(1) : QString();
+		QString low = opt.toLower();
+
+		if (!flag)
+		{
+			if (isSource(arg)) job.sources.append(arg);
+			else job.cacheable = false; // ... i.e. object files or libraries to link.
+			continue;
+		}
+		if (opt == "c")
+		{
+			compile = true;
+			continue;
+		}
+		if (opt.startsWith("Fo"))
+		{
+			output = opt.mid(2);
+			continue;
+		}
+		if (opt.startsWith("Tp") || opt.startsWith("Tc"))
+		{
+			job.sources.append(opt.mid(2));
+			continue;
+		}
+		if (opt.startsWith("Fd") || opt == "nologo")
+			continue;
+
+		if (qtBuilderClNoCache.contains(low))
+			job.cacheable = false;
+		FOR_CONST_IT(qtBuilderClNoCachePrefix)
+			if (opt.startsWith(*IT))
+				job.cacheable = false;
+
+		job.preprocess.append(arg);
+		if (opt == "I" || opt == "D" || opt == "U")
+		{
+			if (++i < args.count())
+				job.preprocess.append(args.at(i));
+			continue;
+		}
+		if (!opt.startsWith('I') && !opt.startsWith('D') && !opt.startsWith('U'))
+			job.flags.append(arg);
+	}
+
+	job.cacheable &= compile && !job.sources.isEmpty();
+	bool folder = output.isEmpty() || output.endsWith('\\') || output.endsWith('/') || QFileInfo(output).isDir();
+	if (!folder && job.sources.count() > 1)
+		job.cacheable = false;
+
+	FOR_CONST_IT(job.sources)
+		job.objects.append(folder ? QDir(output.isEmpty() ? "." : output).filePath(QFileInfo(*IT).completeBaseName()+".obj") : output);
+
+	QByteArray env = qgetenv("CL")+" "+qgetenv("_CL_");
+	job.flags += splitArgs(QString::fromLocal8Bit(env));
+	return job;
+}
+
+static CompileJob parseGcc(const QStringList &args)
+{
+	CompileJob job;
+
+	bool compile = false;
+	QString output;
+	for(int i = 0; i < args.count(); i++)
+	{
+		QString arg = args.at(i);
+		if (!arg.startsWith('-') || arg == "-")
+		{
+			if (arg != "-" && isSource(arg)) job.sources.append(arg);
+			else job.cacheable = false;
+			continue;
+		}
+		if (arg == "-c")
+		{
+			compile = true;
+			continue;
+		}
+		if (arg == "-o")
+		{
+			if (++i < args.count())
+				output = args.at(i);
+			continue;
+		}
+		if (arg.startsWith("-o"))
+		{
+			output = arg.mid(2);
+			continue;
+		}
+		if (qtBuilderGccNoCache.contains(arg))
+			job.cacheable = false;
+
+		job.preprocess.append(arg);
+		if (arg == "-I" || arg == "-D" || arg == "-U" || arg == "-include" || arg == "-isystem")
+		{
+			if (++i < args.count())
+				job.preprocess.append(args.at(i));
+			if (arg == "-include") // ... contents are in the preprocessed output, the flag itself isn't
+				job.flags << arg << args.at(i);
+			continue;
+		}
+		if (!arg.startsWith("-I") && !arg.startsWith("-D") && !arg.startsWith("-U"))
+			job.flags.append(arg);
+	}
+
+	job.cacheable &= compile && job.sources.count() == 1;
+	FOR_CONST_IT(job.sources)
+		job.objects.append(output.isEmpty() ? QFileInfo(*IT).completeBaseName()+".o" : output);
+	return job;
+}
+
+static const QByteArray identity(const QString &compiler)
+{
+	QFileInfo info(compiler);
+	return QString("%1|%2|%3").arg(info.absoluteFilePath()).arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch()).toUtf8();
+}
+
+static const QString objectKey(const QString &compiler, const CompileJob &job, const QString &source)
+{
+	QStringList args = job.preprocess;
+	args << (job.cl ? "/nologo" : "-w") << (job.cl ? "/E" : "-E") << source;
+
+	QProcess p;
+	p.start(compiler, args);
+	if (!p.waitForFinished(-1) || p.exitStatus() != QProcess::NormalExit || p.exitCode())
+		return QString();
+
+	QCryptographicHash h(QCryptographicHash::Sha1);
+	h.addData(identity(compiler));
+	h.addData(job.flags.join(___LF).toUtf8());
+
+	FOR_CONST_IT(job.flags) // ... debug info carries the paths, thus those objects are not shared between folders.
+		if ((*IT).startsWith("-g") || !(*IT).mid(1).compare("Z7", Qt::CaseInsensitive))
+		{
+			h.addData(QDir::currentPath().toUtf8());
+			h.addData(QFileInfo(source).absoluteFilePath().toUtf8());
+			break;
+		}
+
+	QByteArray text = p.readAllStandardOutput();
+	int from = 0;
+	while(from < text.size())
+	{
+		int to = text.indexOf('\n', from);
+		if (to < 0) to = text.size();
+
+		const char *line = text.constData()+from;
+		int length = to-from;
+		bool marker = (length > 5 && !qstrncmp(line, "#line", 5)) || (length > 2 && line[0] == '#' && line[1] == ' ');
+		if (!marker)
+			h.addData(line, length);
+
+		from = to+1;
+	}
+	return h.result().toHex();
+}
+
+static const QString cachePath(const QString &root, const QString &key)
+{
+	return root+SLASH+key.left(2)+SLASH+key.mid(2)+".obj";
+}
+
+static void countStat(char c)
+{
+	QFile stats(QString::fromLocal8Bit(qgetenv(qtBuilderCcStats.toLatin1())));
+	if (!stats.fileName().isEmpty() && stats.open(QIODevice::Append))
+		stats.write(&c, 1);
+}
+
+static int passThrough(const QString &compiler, const QStringList &args)
+{
+	QProcess p;
+	p.setProcessChannelMode(QProcess::ForwardedChannels);
+	p.start(compiler, args);
+	if (!p.waitForFinished(-1) || p.exitStatus() != QProcess::NormalExit)
+		return 1;
+	return p.exitCode();
+}
+
+
+
+bool ObjectCache::wrapped(const QString &program)
+{
+	return qtBuilderCcNames.contains(QFileInfo(program).completeBaseName().toLower());
+}
+
+int ObjectCache::wrap(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QTextStream err(stderr);
+
+	QString name = QFileInfo(QString::fromLocal8Bit(argv[0])).completeBaseName().toLower();
+	QString compiler = realCompiler(name);
+	if (compiler.isEmpty())
+	{
+		err << "QtBuilder: no compiler \"" << name << "\" found in PATH" << endl;
+		return 1;
+	}
+
+	QStringList args = app.arguments().mid(1);
+	QString root = QString::fromLocal8Bit(qgetenv(qtBuilderCcCache.toLatin1()));
+
+	QStringList expanded = expandArgs(args);
+	CompileJob job = name == "cl" ? parseCl(expanded) : parseGcc(expanded);
+	if (root.isEmpty() || !job.cacheable)
+	{
+		countStat('p');
+		return passThrough(compiler, args);
+	}
+
+	QStringList keys;
+	bool all = true;
+	FOR_CONST_IT(job.sources)
+	{
+		QString key = objectKey(compiler, job, *IT);
+		if (key.isEmpty()) // ... let the compiler report the error.
+		{
+			countStat('p');
+			return passThrough(compiler, args);
+		}
+		keys.append(key);
+		all &= QFile::exists(cachePath(root, key));
+	}
+
+	if (all)
+	{
+		QTextStream out(stdout);
+		for(int i = 0; i < keys.count(); i++)
+		{
+			QString cached = cachePath(root, keys.at(i));
+			QString object = job.objects.at(i);
+			QFile::remove(object);
+
+			if (!QFile::copy(cached, object))
+			{
+				countStat('p');
+				return passThrough(compiler, args);
+			}
+			touchFile(object); // ... a copy keeps the cached file time (windows), the object must be newer than its source.
+			touchFile(cached); // ... for the LRU trimming.
+			if (job.cl)
+				out << QFileInfo(job.sources.at(i)).fileName() << endl; // ... as cl does.
+			countStat('h');
+		}
+		return 0;
+	}
+
+	int result = passThrough(compiler, args);
+	for(int i = 0; i < keys.count(); i++)
+	{
+		countStat('m');
+		if (result || !QFile::exists(job.objects.at(i)))
+			continue;
+
+		QString cached = cachePath(root, keys.at(i));
+		QString temp = QString("%1.%2.tmp").arg(cached).arg(QCoreApplication::applicationPid());
+		QDir().mkpath(QFileInfo(cached).absolutePath());
+
+		if (!QFile::copy(job.objects.at(i), temp) || !QFile::rename(temp, cached))
+			QFile::remove(temp); // ... i.e. another process stored it meanwhile.
+	}
+	return result;
+}
+
+bool ObjectCache::install(const QString &shim, QString &error)
+{
+	static QMutex lock; // ... lanes share the shim folder.
+	QMutexLocker locker(&lock);
+
+	if (!QDir(shim).exists() && !QDir().mkpath(shim))
+	{
+		error = QString("can't create %1").arg(QDir::toNativeSeparators(shim));
+		return false;
+	}
+
+	QString app = QCoreApplication::applicationFilePath();
+#ifdef _WIN32
+	//
+	//	the shim is a copy; the dlls next to QtBuilder go along, otherwise the ones of the
+	//	Qt being built (its bin folder is in the build path) would be picked up instead
+	//
+	QMap<QString, QString> files;
+	files.insert(shim+SLASH+qtBuilderCcNames.first()+".exe", app);
+
+	QFileInfoList dlls = QDir(QCoreApplication::applicationDirPath()).entryInfoList(QStringList() << "*.dll", QDir::Files);
+	FOR_CONST_IT(dlls)
+		files.insert(shim+SLASH+(*IT).fileName(), (*IT).absoluteFilePath());
+
+	FOR_CONST_IT(files)
+	{
+		QFileInfo src(IT.value());
+		QFileInfo tgt(IT.key());
+		if (tgt.exists() && tgt.size() == src.size() && tgt.lastModified() == src.lastModified())
+			continue;
+
+		QFile::remove(tgt.absoluteFilePath());
+		if (!QFile::copy(src.absoluteFilePath(), tgt.absoluteFilePath()))
+		{
+			error = QString("can't create %1").arg(QDir::toNativeSeparators(tgt.absoluteFilePath()));
+			return false;
+		}
+		copyFileTime(src.absoluteFilePath(), tgt.absoluteFilePath());
+	}
+#else
+	FOR_CONST_IT(qtBuilderCcNames)
+	{
+		QString name = shim+SLASH+*IT;
+		if (QFileInfo(name).symLinkTarget() == app)
+			continue;
+
+		QFile::remove(name);
+		if (!QFile::link(app, name))
+		{
+			error = QString("can't create %1").arg(QDir::toNativeSeparators(name));
+			return false;
+		}
+	}
+#endif
+	return true;
+}
+
+void ObjectCache::environment(QProcessEnvironment &env, const QString &shim, const QString &root, const QString &stats)
+{
+	QString path = env.value("PATH");
+	env.insert("PATH", QDir::toNativeSeparators(shim)+qtBuilderPathSep+path);
+	env.insert(qtBuilderCcShim,  QDir::toNativeSeparators(shim));
+	env.insert(qtBuilderCcCache, QDir::toNativeSeparators(root));
+	env.insert(qtBuilderCcStats, QDir::toNativeSeparators(stats));
+}
+
+const QString ObjectCache::statistics(const QString &stats, bool reset)
+{
+	QFile file(stats);
+	QByteArray counts;
+	if (file.open(QIODevice::ReadOnly))
+		counts = file.readAll();
+	file.close();
+
+	if (reset)
+		file.remove();
+
+	int hits = counts.count('h'), misses = counts.count('m'), other = counts.count('p');
+	int total = hits+misses;
+	return QString("%1 hits, %2 misses (%3%), %4 not cacheable")
+		.arg(hits).arg(misses).arg(total ? hits*100/total : 0).arg(other);
+}
+
+qint64 ObjectCache::trim(const QString &root, qint64 capMb)
+{	//
+	// least recently used objects go first; hits touch their cache file.
+	//
+	QMultiMap<qint64, QString> files;
+	qint64 total = 0;
+
+	QDirIterator it(root, QStringList() << "*.obj", QDir::Files, QDirIterator::Subdirectories);
+	while(it.hasNext())
+	{
+		it.next();
+		QFileInfo info = it.fileInfo();
+		files.insert(info.lastModified().toMSecsSinceEpoch(), info.absoluteFilePath());
+		total += info.size();
+	}
+
+	qint64 cap = capMb*1024*1024;
+	qint64 removed = 0;
+	if (total <= cap)
+		return removed;
+
+	QMultiMap<qint64, QString>::const_iterator f = files.constBegin();
+	while(total > cap*9/10 && f != files.constEnd())
+	{
+		qint64 size = QFileInfo(f.value()).size();
+		if (QFile::remove(f.value()))
+		{
+			total   -= size;
+			removed += size;
+		}
+		++f;
+	}
+	return removed;
+}
@@ -0,0 +1,230 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QThread>
+
+const quint32 qtBuilderSchemaMagic   = 0x51544f53;
+const quint32 qtBuilderSchemaVersion = 1;
+//
+// the "configure -help" output is parsed once into the switches it knows, grouped by their
+// base name with the -no-/-qt-/-system-/-plugin- forms and (if listed) accepted values;
+// cached per configure binary and Qt version, validation is just a few hash lookups then.
+//
+const QStringList qtBuilderOptionForms = QStringList() << "no" << "qt" << "system" << "plugin";
+
+static QDataStream &operator<<(QDataStream &s, const OptionSpec &o)
+{
+	return s << o.forms << o.values << o.valued;
+}
+
+static QDataStream &operator>>(QDataStream &s, OptionSpec &o)
+{
+	return s >> o.forms >> o.values >> o.valued;
+}
+
+OptionSchema::OptionSchema()
+{
+}
+
+const QByteArray OptionSchema::key(const QString &configure, const QString &version)
+{
+	QFile file(configure);
+	if (!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+
+	QCryptographicHash h(QCryptographicHash::Md5);
+	while(!file.atEnd())
+		h.addData(file.read(1024*1024));
+
+	h.addData(version.toUtf8());
+	return h.result().toHex();
+}
+
+bool OptionSchema::load(const QString &filePath, const QByteArray &key)
+{
+	clear();
+	m_key = key;
+
+	QFile file(filePath);
+	if (key.isEmpty() || !file.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream s(&file);
+	quint32 magic, version;
+	QByteArray k;
+	s >> magic >> version >> k;
+
+	if (s.status() != QDataStream::Ok || magic != qtBuilderSchemaMagic ||
+		version != qtBuilderSchemaVersion || k != key)
+		return false;
+
+	s >> m_options >> m_templates;
+	if (s.status() == QDataStream::Ok)
+		return !isEmpty();
+
+	clear();
+	m_key = key;
+	return false;
+}
+
+bool OptionSchema::save(const QString &filePath) const
+{
+	if (m_key.isEmpty() || isEmpty())
+		return false;
+
+	QString dir = QFileInfo(filePath).absolutePath();
+	if (!QDir(dir).exists() && !QDir().mkpath(dir))
+		return false;
+
+	QString temp = QString("%1.%2.tmp").arg(filePath).arg(qHash(QThread::currentThread()));
+	QFile file(temp);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+
+	QDataStream s(&file);
+	s << qtBuilderSchemaMagic << qtBuilderSchemaVersion << m_key << m_options << m_templates;
+	file.close();
+
+	QFile::remove(filePath); // ... lanes may race here; the content is the same anyway.
+	if (QFile::rename(temp, filePath))
+		return true;
+
+	QFile::remove(temp);
+	return false;
+}
+
+void OptionSchema::clear()
+{
+	m_options.clear();
+	m_templates.clear();
+	m_key.clear();
+}
+
+void OptionSchema::parse(const QString &help)
+{
+	QByteArray key = m_key;
+	clear();
+	m_key = key;
+
+	QRegExp choice("<([^>]*\\|[^>]*)>"); // ... i.e. "-opengl <desktop|es2>"
+	QStringList lines = help.split(QRegExp("[\\r\\n]+"), QString::SkipEmptyParts);
+	FOR_CONST_IT(lines)
+	{
+		QString line = (*IT).trimmed();
+		if (line.startsWith('*') || line.startsWith('+'))
+			line = line.mid(1).trimmed();
+		if (!line.startsWith('-'))
+			continue;
+
+		int dots = line.indexOf(" ..");
+		if (dots > 0)
+			line.truncate(dots);
+
+		QStringList tokens = line.split(QRegExp("[\\s/]+"), QString::SkipEmptyParts);
+		for(int i = 0; i < tokens.count(); i++)
+		{
+			QString token = tokens.at(i);
+			if (!token.startsWith('-') || token.length() < 2)
+				continue;
+
+			QString next = i+1 < tokens.count() ? tokens.at(i+1) : QString();
+			bool valued = next.startsWith('<');
+
+			QStringList values;
+			if (valued && choice.indexIn(next) >= 0)
+				values = choice.cap(1).split('|', QString::SkipEmptyParts);
+
+			add(token, valued, values);
+		}
+	}
+	if (!isEmpty())
+		add("-confirm-license", false); // ... at least for 4.x this is not contained in the help output!
+}
+
+void OptionSchema::add(const QString &option, bool valued, const QStringList &values)
+{
+	QString form, name = split(option, form);
+	int bracket = name.indexOf('<');
+
+	OptionSpec &spec = bracket < 0 ? m_options[name] : m_templates[name.left(bracket)];
+	spec.forms.insert(form);
+	spec.valued |= valued;
+	FOR_CONST_IT(values)
+		if (!spec.values.contains(*IT))
+			 spec.values.append(*IT);
+}
+
+const QString OptionSchema::split(const QString &option, QString &form)
+{
+	QString name = option.mid(1).toLower();
+	form.clear();
+
+	int dash = name.indexOf('-');
+	if (dash > 0 && qtBuilderOptionForms.contains(name.left(dash)) && dash+1 < name.length())
+	{
+		form = name.left(dash);
+		name = name.mid(dash+1);
+	}
+	return name;
+}
+
+bool OptionSchema::accepts(const QString &option) const
+{
+	if (isEmpty())
+		return true; // ... nothing known, nothing to complain about.
+
+	QStringList parts = option.split(' ', QString::SkipEmptyParts);
+	if (parts.isEmpty())
+		return false;
+
+	QString form, name = split(parts.first(), form);
+	const OptionSpec *spec = NULL;
+
+	QHash<QString, OptionSpec>::const_iterator it = m_options.constFind(name);
+	if (it != m_options.constEnd())
+	{
+		spec = &(*it);
+	}
+	else
+	{	//
+		// templates are keyed by their static part; trim the name back dash by dash.
+		//
+		int dash = name.length();
+		while(!spec && (dash = name.lastIndexOf('-', dash-1)) > 0)
+			if ((it = m_templates.constFind(name.left(dash+1))) != m_templates.constEnd())
+				spec = &(*it);
+	}
+
+	if (!spec || !spec->forms.contains(form))
+		return false;
+
+	if (parts.count() > 1 && !spec->values.isEmpty())
+		return spec->values.contains(parts.at(1));
+
+	return true;
+}
@@ -0,0 +1,117 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QDebug>
+
+const int qtBuilderRingSize = 1 << 20; // ... bytes; power of two!
+//
+// one producer (the worker thread reading the process pipes) and one consumer (the gui pulling
+// on a timer); head is only written by the producer, tail only by the consumer. if the gui is
+// behind by more than the ring holds the remainder goes to a temp file, so the process never
+// waits for the gui; the ring is not written again before the consumer took the spilled data.
+//
+OutputRing::OutputRing(int channel, const QString &path) :
+	m_buffer(new char[qtBuilderRingSize]), m_mask(qtBuilderRingSize-1), m_spill(NULL), m_channel(channel), m_path(path)
+{
+}
+
+OutputRing::~OutputRing()
+{
+	delete m_spill;
+	delete[] m_buffer;
+}
+
+void OutputRing::push(const QByteArray &data)
+{
+	int from = 0;
+	if (data.isEmpty())
+		return;
+
+	if (!m_spilling.fetchAndAddAcquire(0))
+	{
+		uint head = (int)m_head;
+		uint tail = m_tail.fetchAndAddAcquire(0);
+		int count = qMin(qtBuilderRingSize-int(head-tail), data.size());
+
+		int pos = head & m_mask;
+		int part = qMin(count, qtBuilderRingSize-pos);
+		memcpy(m_buffer+pos, data.constData(), part);
+		memcpy(m_buffer, data.constData()+part, count-part);
+		m_head.fetchAndStoreRelease(int(head+count));
+
+		if (count == data.size())
+			return;
+		from = count;
+	}
+
+	QMutexLocker l(&m_lock);
+	if (!m_spill)
+	{
+		m_spill = new QTemporaryFile(QDir::tempPath()+"/qtbuilder-XXXXXX.spill");
+		if (!m_spill->open())
+		{
+			qWarning() << "couldn't create output spill file:" << m_spill->fileName();
+			delete m_spill;
+			m_spill = NULL;
+			return; // ... output is lost, but the process goes on!
+		}
+	}
+	m_spilling.fetchAndStoreRelease(1);
+	m_spill->seek(m_spill->size());
+	m_spill->write(data.constData()+from, data.size()-from);
+}
+
+const QByteArray OutputRing::pull()
+{
+	QByteArray result = drain();
+	if (!m_spilling.fetchAndAddAcquire(0))
+		return result;
+
+	QMutexLocker l(&m_lock);
+	result += drain(); // ... written before spilling started, thus older.
+	m_spill->seek(0);
+	result += m_spill->readAll();
+	m_spill->resize(0);
+	m_spilling.fetchAndStoreRelease(0);
+	return result;
+}
+
+const QByteArray OutputRing::drain()
+{
+	uint tail = (int)m_tail;
+	uint head = m_head.fetchAndAddAcquire(0);
+	int count = int(head-tail);
+	if (!count)
+		return QByteArray();
+
+	QByteArray result(count, Qt::Uninitialized);
+	int pos = tail & m_mask;
+	int part = qMin(count, qtBuilderRingSize-pos);
+	memcpy(result.data(), m_buffer+pos, part);
+	memcpy(result.data()+part, m_buffer, count-part);
+	m_tail.fetchAndStoreRelease(int(head));
+	return result;
+}
@@ -37,8 +37,8 @@ QtProcess::QtProcess(QObject *main, bool blockOutput) : QProcess(),
 
 	if (!blockOutput)
 	{
-		connect(this, SIGNAL(readyReadStandardOutput()), m_bld, SLOT(procOutput()), Qt::BlockingQueuedConnection);
-		connect(this, SIGNAL(readyReadStandardError()),  m_bld, SLOT(procError()),  Qt::BlockingQueuedConnection);
+		attach(OutputRing::Output, m_out);
+		attach(OutputRing::Error,  m_err);
 	}
 	{	connect(this, SIGNAL(readyReadStandardOutput()),  this, SLOT(checkQuit()));
 		connect(this, SIGNAL(readyReadStandardError()),   this, SLOT(checkQuit()));
@@ -49,19 +49,52 @@ QtProcess::QtProcess(QObject *main, bool blockOutput) : QProcess(),
 
 QtProcess::~QtProcess()
 {
+	readOut();
+	readErr();
 	close();
+
+	if (m_out) m_out->close();
+	if (m_err) m_err->close();
+}
+
+void QtProcess::attach(int channel, OutputRingPtr &ring, const QString &path)
+{	//
+	// the pipes are read in the worker thread without waiting for the gui, which pulls
+	// the rings on its own pace (see QtBuilder::pullOutput).
+	//
+	if (!m_bld || ring)
+		return;
+
+	ring = OutputRingPtr(new OutputRing(channel, path));
+	m_bld->attach(ring);
+
+	if (channel == OutputRing::Error)
+		 connect(this, SIGNAL(readyReadStandardError()),  this, SLOT(readErr()));
+	else connect(this, SIGNAL(readyReadStandardOutput()), this, SLOT(readOut()));
+}
+
+void QtProcess::readOut()
+{
+	if (m_out)
+		m_out->push(readAllStandardOutput());
+}
+
+void QtProcess::readErr()
+{
+	if (m_err)
+		m_err->push(readAllStandardError());
 }
 
 void QtProcess::sendStdOut()
 {
-	if (m_bld)
-		CALL_QUEUED(m_bld, procOutput);
+	attach(OutputRing::Output, m_out);
+	readOut();
 }
 
 void QtProcess::sendStdErr()
 {
-	if (m_bld)
-		CALL_QUEUED(m_bld, procError);
+	attach(OutputRing::Error, m_err);
+	readErr();
 }
 
 void QtProcess::checkQuit()
@@ -82,10 +115,7 @@ void QtProcess::checkQuit()
 		// "taskkill" is the way to go; since these processes only write the the temp dir
 		// structure any left-over garbage is going to be cleared on the next file sync!!
 		//
-		QProcess prc;
-		qWarning()<<QString("taskkill /F /T /PID %1").arg((int)pid()->dwProcessId);
-		prc.execute(QString("taskkill /F /T /PID %1").arg((int)pid()->dwProcessId));
-		waitForFinished(5000);
+		killTree();
 	}
 	if (state() == Running) for(int i = 0; i < 2; i++)
 	{
@@ -96,8 +126,8 @@ void QtProcess::checkQuit()
 	if (state() == Running) for(int i = 0; i < 3; i++)
 	{
 #ifdef _WIN32
-		GenerateConsoleCtrlEvent(0, pid()->dwProcessId);
-		GenerateConsoleCtrlEvent(1, pid()->dwProcessId);
+		GenerateConsoleCtrlEvent(0, (DWORD)processId());
+		GenerateConsoleCtrlEvent(1, (DWORD)processId());
 		if (waitForFinished(5000))
 			break;
 #endif
@@ -111,10 +141,7 @@ void QtProcess::checkQuit()
 	}
 	if (state() == Running && !qtBuilderTaskKillFirst)
 	{
-		QProcess prc;
-		qWarning()<<QString("taskkill /F /T /PID %1").arg((int)pid()->dwProcessId);
-		prc.execute(QString("taskkill /F /T /PID %1").arg((int)pid()->dwProcessId));
-		waitForFinished(5000);
+		killTree();
 	}
 	if (state() == Running) // note: if none of the above could end the spawned process(es), this is literally the last measure.
 	{
@@ -124,12 +151,41 @@ void QtProcess::checkQuit()
 }
 
 
+qint64 QtProcess::processId() const
+{
+#ifdef _WIN32
+	return pid() ? (qint64)pid()->dwProcessId : 0;
+#else
+	return (qint64)pid();
+#endif
+}
+
+void QtProcess::killTree()
+{	//
+	// note: on Linux only the direct children (i.e. those of make) are killed along; their
+	// compilers end with the closed pipes, the process itself is killed further down.
+	//
+#ifdef _WIN32
+	QString cmd = QString("taskkill /F /T /PID %1").arg(processId());
+#else
+	QString cmd = QString("pkill -KILL -P %1").arg(processId());
+#endif
+	QProcess prc;
+	qWarning()<<cmd;
+	prc.execute(cmd);
+	waitForFinished(5000);
+}
+
 
 InlineProcess::InlineProcess(QtCompile *compile, const QString &prog, const QString &args, bool blockOutput)
 	: QtProcess(compile->parent(), blockOutput)
 {
+#ifdef _WIN32
 	setNativeArguments(args);
 	start(prog);
+#else
+	start(prog+" "+args);
+#endif
 	waitForFinished(-1);
 }
 
@@ -147,8 +203,8 @@ BuildProcess::BuildProcess(QtCompile *compile, bool blockOutput) : QtProcess(com
 
 	if (!blockOutput)
 	{
-		connect(this, SIGNAL(readyReadStandardOutput()), m_bld, SLOT(procLog()),	Qt::BlockingQueuedConnection);
-		connect(this, SIGNAL(readyReadStandardError()),  m_bld, SLOT(procError()),	Qt::BlockingQueuedConnection);
+		attach(OutputRing::Build, m_out, workingDirectory());
+		attach(OutputRing::Error, m_err);
 	}
 }
 
@@ -158,14 +214,29 @@ BuildProcess::~BuildProcess()
 
 void BuildProcess::setArgs(const QString &args)
 {
+	m_args = args;
+#ifdef _WIN32
 	if (!args.isEmpty())
 		setNativeArguments(args);
+#endif
 }
 
 void BuildProcess::start(const QString &prog)
-{
-	QDir::setCurrent(workingDirectory());
-	QProcess::start(prog);
+{	//
+	// the tools in the working folder (jom, configure) are started by their full path; the
+	// process-wide current folder is shared by all lanes and thus not to be relied upon.
+	//
+	if (m_out) // ... set before any output is pushed, taken by the gui with the first output.
+		m_out->setLabel(QString("%1 %2").arg(prog, m_args).trimmed());
+
+	QString local = workingDirectory()+SLASH+prog;
+	QString program = !workingDirectory().isEmpty() && QFileInfo(local).isFile() ?
+		QString("\"%1\"").arg(QDir::toNativeSeparators(local)) : prog;
+#ifdef _WIN32
+	QProcess::start(program);
+#else
+	QProcess::start(m_args.isEmpty() ? program : program+" "+m_args); // ... no native arguments; split by QProcess.
+#endif
 }
 
 bool BuildProcess::result()
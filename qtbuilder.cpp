@@ -33,6 +33,8 @@
 
 Q_REGISTER_METATYPE(Modes)
 
+const int qtBuilderPullRate = 40; // ... ms; process output is taken from the rings at this rate.
+
 class QtBuildSettings
 {
 public:
@@ -89,6 +91,8 @@ QtBuilder::QtBuilder(QWidget *parent) : QMainWindow(parent),
 	m_log(NULL), m_cpy(NULL), m_tgt(NULL), m_tmp(NULL)
 {
 	m_qtc = new QtCompile(this);
+	m_bus = new EventBus(this);
+	m_bus->attach(this);
 
 	m_opts.append(&m_confs);
 	m_opts.append(&m_archs);
@@ -102,9 +106,11 @@ QtBuilder::QtBuilder(QWidget *parent) : QMainWindow(parent),
 	setupDefaults();
 	createUi();
 
-	connect(m_qtc,	 SIGNAL(diskOp(int, bool, int)), this, SLOT(diskOp(int,bool,int)),	Qt::BlockingQueuedConnection);
-	connect(m_qtc,	 SIGNAL(current(const Modes &)), this, SLOT(nextBuild()),			Qt::BlockingQueuedConnection);
+	connect(m_qtc,	 SIGNAL(diskOp(int, bool, int)), m_bus, SLOT(diskOp(int,bool,int)),	Qt::DirectConnection);
+	connect(m_qtc,	 SIGNAL(current(const Modes &)), m_bus, SLOT(current(const Modes &)),	Qt::DirectConnection);
 	connect(&m_loop, SIGNAL(finished()),			 this, SLOT(processed()));
+	connect(&m_pull, SIGNAL(timeout()),				 this, SLOT(pullOutput()));
+	m_pull.start(qtBuilderPullRate);
 }
 
 QtBuilder::~QtBuilder()
@@ -130,6 +136,9 @@ void QtBuilder::closeEvent(QCloseEvent *event)
 
 void QtBuilder::end()
 {
+	flushOutput();
+	LogWriter::instance()->stop();
+
 	Q_SET_SET(SETTINGS_GEOMETRY, saveGeometry());
 	qApp->setProperty("result", (int)m_qtc->state);
 
@@ -152,6 +161,11 @@ void QtBuilder::show()
 	if(QDir(m_libPath).exists())
 		 m_tgt->setDrive(m_libPath);
 	else m_log->add("Target path missing:", QDir::toNativeSeparators(m_libPath), Critical);
+
+	m_qtc->trashBin().setRoot(m_libPath+SLASH+qtBuildTrash);
+	if (int count = m_qtc->trashBin().purge())
+		m_log->add("Purging left-over trash:", QString("%1 folder(s) in %2").arg(count)
+			.arg(QDir::toNativeSeparators(m_libPath+SLASH+qtBuildTrash)), Warning);
 }
 
 void QtBuilder::option(int opt, int value)
@@ -222,6 +236,9 @@ void QtBuilder::process(bool start)
 
 void QtBuilder::processed()
 {
+	m_bus->drain();
+	flushOutput();
+
 	QString msg("QtBuilder ended with:");
 	if (m_qtc->failed())
 	{
@@ -288,28 +305,75 @@ void QtBuilder::diskOp(int to, bool start, int count)
 	}
 }
 
-void QtBuilder::procLog()
+void QtBuilder::attach(const OutputRingPtr &ring)
 {
-	CALL_QUEUED(m_tmp, refresh);
-	if (QtProcess *p = qobject_cast<QtProcess *>(sender()))
-		m_bld->append(QtAppLog::clean(p->stdOut()), p->workingDirectory());
+	QMutexLocker l(&m_ringLock);
+	m_rings.append(ring);
 }
 
-void QtBuilder::procError()
+void QtBuilder::pullOutput()
 {
-	if (QtProcess *p = qobject_cast<QtProcess *>(sender()))
-		m_log->add("Process message", QtAppLog::clean(p->stdErr(), true), Process);
+	QList<OutputRingPtr> rings;
+	{	QMutexLocker l(&m_ringLock);
+		rings = m_rings;
+	}
+	FOR_CONST_IT(rings)
+	{
+		bool done = (*IT)->closed(); // ... before pulling, nothing is pushed after closing.
+		QString text = (*IT)->pull();
+
+		if (!text.isEmpty()) switch((*IT)->channel())
+		{
+		case OutputRing::Build:
+		{	QString label = (*IT)->takeLabel();
+			if (!label.isEmpty())
+				m_bld->mark(label, (*IT)->path());
+
+			CALL_QUEUED(m_tmp, refresh);
+			m_bld->append(QtAppLog::clean(text), (*IT)->path());
+		}	break;
+		case OutputRing::Output:
+			m_log->add("Process informal", QtAppLog::clean(text, true), Informal);
+			break;
+		case OutputRing::Error:
+			m_log->add("Process message", QtAppLog::clean(text, true), Process);
+			break;
+		}
+		if (done)
+		{
+			QMutexLocker l(&m_ringLock);
+			m_rings.removeOne(*IT);
+		}
+	}
 }
 
-void QtBuilder::procOutput()
-{
-	if (QtProcess *p = qobject_cast<QtProcess *>(sender()))
-		m_log->add("Process informal", QtAppLog::clean(p->stdOut(), true), Informal);
+void QtBuilder::flushOutput()
+{	//
+	// all process output pulled and written, the log files closed; i.e. before a build
+	// folder (with its log) is moved or copied, when the run ended or the app quits.
+	//
+	pullOutput();
+	LogWriter::instance()->flush(true);
 }
 
-void QtBuilder::nextBuild()
+void QtBuilder::busEvent(const BusEvent &event)
 {
-	m_bld->clear();
+	switch(event.kind)
+	{
+	case BusEvent::Log:		m_log->add(event.msg, event.text, event.type);		 break;
+	case BusEvent::DiskOp:	diskOp(event.to, event.start, event.count);			 break;
+	case BusEvent::Current: nextBuild(event.modes);								 break;
+	}
+}
+
+void QtBuilder::nextBuild(const Modes &modes)
+{	//
+	// the build view is shared by all lanes; a single variant in progress sets exactly one flag per
+	// msvc, arch and type, more means other lanes are still running and their output is kept.
+	//
+	pullOutput(); // ... the output of the previous variant goes first.
+	if (modes.keys(true).count() <= 3)
+		m_bld->clear();
 	m_tmp->reset();
 }
 
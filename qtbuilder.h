@@ -31,6 +31,7 @@
 #include <QProgressBar>
 #include <QTextBrowser>
 #include <QTextEdit>
+#include <QAbstractScrollArea>
 #include <QCheckBox>
 #include <QSlider>
 #include <QLabel>
@@ -45,6 +46,19 @@
 #include <QPaintEvent>
 #include <QFileInfo>
 #include <QDir>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSharedPointer>
+#include <QHash>
+#include <QQueue>
+#include <QVector>
+#include <QSet>
+#include <QThreadPool>
+#include <QThread>
+#include <QDateTime>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <QTextTable>
 
 struct Range
 {
@@ -81,6 +95,96 @@ typedef QMap<int, Range> Ranges;
 typedef QMap<int, bool>  Modes;
 Q_DECLARE_METATYPE(Modes)
 
+class FramedLog
+{
+public:
+	explicit FramedLog(const QString &filePath);
+	virtual ~FramedLog();
+
+	bool open();
+	void write(const QByteArray &data);
+	void mark(const QString &label);
+	void flush(bool final = false);
+	void sync();
+
+	static const QStringList files(const QString &filePath);
+
+protected:
+	void frame(int length);
+
+private:
+	QFile m_data;
+	QFile m_index;
+	QByteArray m_raw;
+	qint64 m_line;
+};
+
+class LogReader
+{
+public:
+	struct Frame { qint64 offset; qint32 size; qint32 raw; qint64 line; qint32 lines; };
+	struct Mark  { qint64 line; QString label; };
+	typedef QPair<qint64, QString> Hit;
+
+	bool open(const QString &filePath);
+
+	inline qint64 lines() const { return m_lines; }
+	inline const QList<Mark> &marks() const { return m_marks; }
+
+	const QByteArray frame(int index);
+	const QStringList lines(qint64 from, int count);
+	const QStringList tail(int count);
+	const QList<Hit> search(const QRegExp &rx, int maxHits, qint64 from = 0);
+	const QString lastError();
+
+protected:
+	int frameOf(qint64 line) const;
+
+private:
+	QFile m_data;
+	QList<Frame> m_frames;
+	QList<Mark> m_marks;
+	qint64 m_lines;
+};
+
+class LogWriter : public QThread
+{
+public:
+	static LogWriter *instance();
+
+	void write(const QString &filePath, const QByteArray &data);
+	void writeFramed(const QString &filePath, const QByteArray &data);
+	void mark(const QString &filePath, const QString &label);
+	void flush(bool close = false);
+	void stop();
+
+protected:
+	explicit LogWriter();
+	virtual ~LogWriter();
+
+	enum Chunk { Plain = 0, Framed, Marker };
+	void post(const QString &filePath, int kind, const QByteArray &data);
+	void run();
+
+	QFile *plainFile(const QString &filePath);
+	FramedLog *framedLog(const QString &filePath);
+
+private:
+	QHash<QString, QList<QPair<int, QByteArray> > > m_pending;
+	QHash<QString, QFile *> m_files;
+	QHash<QString, FramedLog *> m_frames;
+	QStringList m_order;
+	QMutex m_lock;
+	QWaitCondition m_wake;
+	QWaitCondition m_done;
+	int m_pendingBytes;
+	int m_requested;
+	int m_flushed;
+	bool m_close;
+	bool m_sync;
+	bool m_stop;
+};
+
 class QtAppLog : public QTextBrowser
 {
 	Q_OBJECT
@@ -96,34 +200,85 @@ public slots:
 	void add(const QString &msg, const QString &text, int type);
 	void add(const QString &msg, int type = Informal);
 
+protected slots:
+	void scrolled(int value);
+
 protected:
 	void paintEvent(QPaintEvent *event);
 
+	bool spill(const QString &ts, int type, const QString &msg, const QString &text);
+	bool readRow(int index, QString &ts, int &type, QString &msg, QString &text);
+	void insertRow(int at, const QString &ts, int type, const QString &msg, const QString &text);
+	void trimRows();
+
 private:
 	QMap<int, QString> m_info;
-	QStringList m_timestamp;
-	QStringList m_message;
-	QStringList m_description;
+	QSet<uint>	m_hashes;
+	QQueue<uint> m_hashOrder;
+	QVector<qint64> m_index;
+	QTemporaryFile m_spill;
+	QTextTable *m_table;
 	QString		m_logFile;
-	QList<int>  m_type;
+	int m_first;
 };
 
-class BuildLog : public QTextEdit
+class BuildLog : public QAbstractScrollArea
 {
 	Q_OBJECT
 
 public:
 	explicit BuildLog(QWidget *parent = 0);
-	const QString logFile();
+	static const QString logFile();
+
+	void clear();
 
 public slots:
 	void append(const QString &text, const QString &path);
+	void mark(const QString &label, const QString &path);
 
 	void endFailure();
 	void endSuccess();
 
+protected slots:
+	void refresh();
+
+protected:
+	void addLine(const QString &line, bool viewOnly = false);
+	void release();
+	void rewind(qint64 first);
+	void find(const QString &text);
+	const QString line(qint64 index);
+	qint64 fileLine(qint64 index) const;
+	qint64 viewLine(qint64 fileLine) const;
+	int visibleLines() const;
+	void invalidate();
+
+	void paintEvent(QPaintEvent *event);
+	void resizeEvent(QResizeEvent *event);
+	void scrollContentsBy(int dx, int dy);
+	void mousePressEvent(QMouseEvent *event);
+	void mouseMoveEvent(QMouseEvent *event);
+	void keyPressEvent(QKeyEvent *event);
+
 private:
-	QString m_logFile;
+	QVector<QString> m_ring;
+	qint64 m_total;
+	qint64 m_fileLines;
+	QList<qint64> m_viewOnly;
+	QStringList m_held;
+	QSet<QString> m_paths;
+	QString m_path;
+
+	LogReader m_reader;
+	qint64 m_readerBase;
+	qint64 m_chunkFrom;
+	QStringList m_chunk;
+	bool m_reopened;
+	QString m_find;
+
+	QTimer m_frame;
+	qint64 m_selFrom;
+	qint64 m_selTo;
 	int m_lineCount;
 };
 
@@ -371,8 +526,236 @@ protected:
 
 	QMap<int, int>	m_bopts;
 	QStringList m_msvcBOpts;
-	QStringList m_dirFilter;
-	QStringList m_extFilter;
+};
+
+class PathFilter
+{
+public:
+	explicit PathFilter();
+
+	void compile(const QStringList &dirs, const QStringList &exts);
+	bool matchDir(const QString &dirPath, bool isRoot) const;
+	bool matchExt(const QString &fileName) const;
+
+	inline bool hasExtensions() const { return !m_exts.isEmpty() || !m_extGlobs.isEmpty(); }
+
+protected:
+	enum Anchor { Nowhere = 0, Anywhere = 1, Rooted = 2 };
+	struct Node
+	{
+		Node() : anchor(Nowhere) {}
+		QHash<QChar, int> next;
+		int anchor;
+	};
+	static bool isGlob(const QString &pattern);
+	void insert(const QString &pattern, int anchor);
+
+private:
+	QVector<Node> m_nodes;
+	QList<QPair<QRegExp, int> > m_dirGlobs;
+	QList<QRegExp> m_extGlobs;
+	QSet<QString> m_exts;
+	int m_extLength;
+};
+
+struct ManifestFile
+{
+	ManifestFile() : size(0), mtime(0), inode(0), hash(0) {}
+
+	QString name;
+	qint64  size;
+	qint64  mtime;
+	quint64 inode;
+	quint64 hash;
+};
+
+struct ManifestDir
+{
+	ManifestDir() : mtime(0) {}
+
+	qint64 mtime;
+	QList<ManifestFile> files;
+	QStringList dirs;
+};
+
+class SourceManifest
+{
+public:
+	explicit SourceManifest();
+	virtual ~SourceManifest();
+
+	bool load(const QString &filePath, const QString &root);
+	bool save();
+	void clear();
+
+	inline bool isLoaded() const { return !m_root.isEmpty(); }
+	inline int scanned() const { return m_scanned; }
+	inline int reused() const { return m_reused; }
+
+	bool listing(const QString &dirPath, ManifestDir &dir);
+	static bool scan(const QString &dirPath, ManifestDir &dir, bool identify = false);
+
+protected:
+	bool cached(const QString &key, ManifestDir &dir);
+
+private:
+	QHash<QString, quint64> m_index;
+	QHash<QString, ManifestDir> m_dirs;
+	QMutex m_mutex;
+	QFile  m_file;
+	uchar *m_map;
+	qint64 m_size;
+
+	QString m_root;
+	int m_scanned;
+	int m_reused;
+};
+
+struct OptionSpec
+{
+	OptionSpec() : valued(false) {}
+
+	QSet<QString> forms;	// ... "", "no", "qt", "system", "plugin"
+	QStringList values;
+	bool valued;
+};
+
+class OptionSchema
+{
+public:
+	explicit OptionSchema();
+
+	static const QByteArray key(const QString &configure, const QString &version);
+
+	bool load(const QString &filePath, const QByteArray &key);
+	bool save(const QString &filePath) const;
+	void parse(const QString &help);
+	void clear();
+
+	bool accepts(const QString &option) const;
+	inline bool isEmpty() const { return m_options.isEmpty(); }
+	inline int count() const { return m_options.count()+m_templates.count(); }
+
+protected:
+	void add(const QString &option, bool valued, const QStringList &values = QStringList());
+	static const QString split(const QString &option, QString &form);
+
+private:
+	QHash<QString, OptionSpec> m_options;
+	QHash<QString, OptionSpec> m_templates;	// ... i.e. "-qt-sql-<driver>", keyed by "sql-"
+	QByteArray m_key;
+};
+
+class EnvironmentCache
+{
+public:
+	static const QByteArray key(const QString &call, const QString &script, const QStringList &base);
+	static bool valid(const QStringList &lines);
+	static bool load(const QString &filePath, const QByteArray &key, QStringList &lines);
+	static bool save(const QString &filePath, const QByteArray &key, const QStringList &lines);
+};
+
+class GeneratedCache
+{
+public:
+	static int seed(const QString &root, const QString &build, const QString &version);
+	static int store(const QString &root, const QString &build, const QString &version);
+};
+
+class ObjectCache
+{
+public:
+	static bool wrapped(const QString &program);
+	static int wrap(int argc, char *argv[]);
+	static bool install(const QString &shim, QString &error);
+	static void environment(QProcessEnvironment &env, const QString &shim, const QString &root, const QString &stats);
+	static const QString statistics(const QString &stats, bool reset);
+	static qint64 trim(const QString &root, qint64 capMb);
+};
+
+class ConfigureCache
+{
+public:
+	static const QByteArray key(const QString &config, const QString &mkSpec, const QProcessEnvironment &env, const QByteArray &sources);
+	static const QByteArray fingerprint(const QString &source);
+	static bool restore(const QString &filePath, const QString &root, int &count);
+	static bool store(const QString &filePath, const QString &root, const QDateTime &since, int &count, const QStringList &only = QStringList());
+};
+
+class TrashBin
+{
+public:
+	explicit TrashBin();
+	virtual ~TrashBin();
+
+	void setRoot(const QString &root);
+	bool trash(const QString &path);
+	int  purge();
+	void wait();
+
+	inline bool cancelled() const { return m_cancel; }
+	static bool removeTree(const QString &path, const TrashBin *bin = 0);
+	static bool removeLink(const QString &path);
+
+protected:
+	friend class TrashJob;
+	void schedule(const QString &path);
+	void done();
+
+private:
+	QString m_root;
+	QAtomicInt m_cancel;
+	QAtomicInt m_serial;
+	QAtomicInt m_pending;
+	QMutex m_lock;
+	QWaitCondition m_done;
+};
+
+class QtCompile;
+class ScratchVolume
+{
+public:
+	enum Backend { ImDisk, Directory, Tmpfs, Zram };
+
+	explicit ScratchVolume(QtCompile *compile);
+	virtual ~ScratchVolume();
+
+	static ScratchVolume *create(QtCompile *compile);
+
+	virtual const QString name() const = 0;
+	virtual bool attach(int sizeGb) = 0;
+	virtual bool detach(bool force) = 0;
+	virtual bool resize(int sizeGb) = 0;
+	virtual bool size(uint &totalMb, uint &freeMb) const;
+	virtual bool shrinkable() const { return true; }
+
+	void watch();
+	void unwatch();
+	bool grow();
+	bool shrink();
+
+	inline const QString &root() const { return m_root; }
+	inline bool kept() const { return m_keep; }
+	inline int sizeGb() const { return m_size; }
+
+protected:
+	void log(const QString &msg, const QString &text = QString(), int type = Informal);
+	bool run(const QString &prog, const QString &args, QString *out = 0, bool silent = true);
+
+	friend class ScratchWatcher;
+
+	QtCompile *m_compile;
+	QString m_root;
+	bool m_keep;
+	int m_size;
+	int m_base;
+
+private:
+	QThreadPool m_pool;
+	QMutex m_lock;
+	QMutex m_idle;
+	QWaitCondition m_wake;
+	QAtomicInt m_stop;
 };
 
 class QtBuildState : public QObject, public QElapsedTimer
@@ -432,6 +815,9 @@ class QtCompile : public QtBuildState, public QtBuilderBase
 {
 	Q_OBJECT
 
+	friend class CopyEngine;
+	friend class ScratchVolume;
+
 signals:
 	void current(const Modes &modes);
 	void progress(int count, const QString &file, qreal mbs);
@@ -443,10 +829,12 @@ signals:
 
 public:
 	explicit QtCompile(QtBuilder *main);
+	virtual ~QtCompile();
 
 	inline const QProcessEnvironment &environment() const { return m_env ; }
 	inline const QString buildLogFile() const { return  logFile(m_target); }
 	inline const QString targetFolder() const { return			m_target ; }
+	inline TrashBin &trashBin() { return m_trash; }
 
 	void  sync();
 	void  loop();
@@ -454,8 +842,27 @@ public:
 
 protected slots:
 	void cancel() { state = Cancel; }
+	void laneLog(const QString &msg, int type);
+	void laneLog(const QString &msg, const QString &text, int type);
 
 protected:
+	struct Variant { int msvc, arch, type; };
+	explicit QtCompile(QtCompile *master, int lane, QtCompile *owner = 0);
+
+	void drain();
+	bool publish();
+	bool published();
+	bool publishing();
+
+	void prefetch();
+	bool prefetched(int msvc, int arch, int type);
+	bool prefetching(int msvc, int arch, int type);
+	bool peekVariant(Variant &v);
+	bool build(int msvc, int arch, int type);
+	bool nextVariant(Variant &v);
+	void running(int msvc, int arch, int type, bool active);
+	const Modes modes(bool active) const;
+
 	bool removeTemp();
 	bool createTemp();
 	bool createTgt (int msvc, int type, int arch);
@@ -469,39 +876,273 @@ protected:
 	bool cleaning ();
 	bool finalize ();
 
+	void lastError();
+	bool hostTools(const QString &args);
+	const QByteArray hostToolsKey();
+	void storeGenerated();
+	inline const QByteArray &sources() const { return (m_master ? m_master : this)->m_sources; }
+
 	void checkOptions(QStringList &opts);
-	bool setEnvironment(const QString &vcVars, const QString &mkSpec);
+	const OptionSchema &optionSchema();
+	const QString vcVarsScript(int msvc) const;
+	const QString vcVarsCall(int msvc, int arch) const;
+	const QString configOptions(int msvc, int type, bool check);
+	const QProcessEnvironment baseEnvironment();
+	bool setEnvironment(int msvc, int arch);
+	bool captureEnvironment(const QString &vcVars, QStringList &lines);
 	void writeQtVars(const QString &path, const QString &vcVars, int msvc);
 
 	bool checkDir(int which);
 	bool checkDir(int which, QString &path);
-	bool checkDir(int which, QString &path, int &count, bool skipRootFiles = false);
 
-	bool attachImdisk(QString &letter);
-	bool removeImdisk(bool silent, bool force);
 	bool writeTextFile(const QString &filePath, const QString &text);
 
 	int copyFolder(int fr,  int to, bool synchronize = true, bool skipRootFiles = false);
 	void clearPath(const QString &dirPath);
 	bool removeDir(const QString &dirPath, const QStringList &inc = QStringList());
-	bool filterDir(const QString &dirPath, bool isRoot);
-	bool filterExt(const QFileInfo &info);
+	bool filterDir(const QString &dirPath, bool isRoot) const;
+	bool filterExt(const QString &fileName) const;
 	bool filterPath(const QString &eLine);
 
 	const QString logFile(const QString &path) const;
-	const QString driveLetter();
+	const QString provenance(int msvc, int arch, int type);
+	bool upToDate(int msvc, int arch, int type);
 	const QString targetDir(int msvc, int arch, int type, QString &native, QStringList &t = QStringList());
 
 private:
+	QtCompile *m_master;
+	QtCompile *m_owner;
+	QtCompile *m_publisher;
+	QtCompile *m_prefetcher;
+	QFuture<bool> m_publish;
+	QFuture<bool> m_prefetch;
+	bool m_publishing;
+	bool m_prefetching;
+	Variant m_next;
+	Variant m_variant;
+	OptionSchema m_schema;
+	QString m_provenance;
+	QByteArray m_sources;
+	QList<QtCompile *> m_lanes;
+	QQueue<Variant> m_pending;
+	QMap<int, int> m_running;
+	QAtomicInt m_halt;
+	QMutex m_queue;
+	int m_lane;
+
+	SourceManifest m_manifest;
+	PathFilter m_filter;
+	TrashBin m_trash;
 	QProcessEnvironment	m_env;
-	uint m_imdiskUnit;
-	bool m_keepDisk;
+	ScratchVolume *m_scratch;
 	QString m_drive;
 	QString m_build;
 	QString m_btemp;
 };
 
-class QtBuilder : public QMainWindow, public QtBuilderBase
+class CopyBackend
+{
+public:
+	enum Method { Reflink, CopyRange, SendFile, SystemCopy, Buffered, Methods };
+
+	explicit CopyBackend();
+
+	bool copy(const QString &source, const QString &target);
+	bool copyRange(const QString &source, const QString &target, qint64 offset, qint64 length);
+	void counted(int method) { m_counts[method].ref(); }
+
+	inline bool cloning() const { return m_cloning; }
+	inline int rangeMethod() const { return m_range; }
+	const QString summary() const;
+
+protected:
+	int  first(quint64 srcDev, quint64 tgtDev);
+	void next (quint64 srcDev, quint64 tgtDev, int method);
+
+private:
+	QHash<QPair<quint64, quint64>, int> m_pairs;
+	QAtomicInt m_counts[Methods];
+	QAtomicInt m_cloning;
+	QAtomicInt m_range;
+	QMutex m_mutex;
+};
+
+struct CopyTask
+{
+	enum Type { Folder, File, Chunk, RemoveFiles, RemoveDirs };
+	CopyTask() : type(Folder), depth(0), replace(false), size(0), mtime(0), offset(0), length(0) {}
+
+	int type;
+	int depth;
+	bool replace;
+	qint64 size;
+	qint64 mtime;
+	qint64 offset;
+	qint64 length;
+	QString source;
+	QString target;
+	QStringList batch;
+	QSharedPointer<QAtomicInt> parts;
+};
+
+class CopyEngine
+{
+public:
+	explicit CopyEngine(QtCompile *compile, bool synchronize, bool skipRootFiles, SourceManifest *manifest = 0, int threads = 0);
+	virtual ~CopyEngine();
+
+	int run(int to, const QString &source, const QString &target, int maximum);
+	void work(int index);
+
+	inline int threads() const { return m_queues.count(); }
+	inline int scanned() const { return m_scanned; }
+	inline const CopyBackend &backend() const { return m_backend; }
+	const QString summary() const;
+
+protected:
+	struct WorkQueue
+	{
+		QMutex mutex;
+		QList<CopyTask> tasks;
+	};
+
+	void push(int index, const CopyTask &task, bool bounded = false);
+	bool take(int index, CopyTask &task);
+	void done();
+	bool fail(const QString &msg, const QString &path);
+
+	void scan(const QString &source, const QString &target);
+	bool scanFolder(const CopyTask &task, QQueue<CopyTask> &queue);
+	void removeLater(const QFileInfo &info);
+	void flushRemovals(bool all);
+	bool remove(const CopyTask &task);
+
+	bool copyFile(int index, const CopyTask &task);
+	bool copyChunked(int index, const QString &src, qint64 size, const QString &tgt);
+	bool copyChunk(const CopyTask &task);
+	void counted(const QString &native, qint64 size);
+
+private:
+	QtCompile *m_compile;
+	SourceManifest *m_manifest;
+	CopyBackend m_backend;
+	QList<WorkQueue *> m_queues;
+	QElapsedTimer m_timer;
+	CopyTask m_removeFiles;
+	CopyTask m_removeDirs;
+
+	QMutex m_idle;
+	QMutex m_stats;
+	QWaitCondition m_wake;
+	QWaitCondition m_space;
+	QAtomicInt m_pending;
+	QAtomicInt m_failed;
+
+	bool m_synchronize;
+	bool m_skipRootFiles;
+	bool m_scanning;
+	bool m_filter;
+
+	qint64 m_emitted;
+	qint64 m_bytes;
+	qint64 m_msecs;
+	int m_count;
+
+	int m_to;
+	int m_next;
+	int m_scanned;
+	int m_maximum;
+};
+
+struct BusEvent
+{
+	enum Kind { Log = 0, DiskOp, Current };
+	BusEvent() : kind(Log), type(Informal), to(-1), start(false), count(0) {}
+
+	int kind;
+	QString msg;
+	QString text;
+	int type;
+	int to;
+	bool start;
+	int count;
+	Modes modes;
+};
+
+class EventSink
+{
+public:
+	virtual ~EventSink() {}
+	virtual void busEvent(const BusEvent &event) = 0;
+};
+
+struct BusNode;
+class EventBus : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit EventBus(QObject *parent = 0);
+	virtual ~EventBus();
+
+	void attach(EventSink *sink);
+
+public slots:
+	void log(const QString &msg, int type);
+	void log(const QString &msg, const QString &text, int type);
+	void diskOp(int to, bool start, int count);
+	void current(const Modes &modes);
+	void drain();
+
+protected:
+	void post(const BusEvent &event, bool flush = false);
+
+private:
+	QAtomicPointer<BusNode> m_head;
+	BusNode *m_tail;
+	QList<EventSink *> m_sinks;
+	QTimer m_frame;
+};
+
+class OutputRing
+{
+public:
+	enum Channel { Build = 0, Output, Error };
+
+	explicit OutputRing(int channel, const QString &path = QString());
+	virtual ~OutputRing();
+
+	void push(const QByteArray &data);
+	const QByteArray pull();
+
+	inline void close() { m_closed.fetchAndStoreRelease(1); }
+	inline bool closed() { return m_closed.fetchAndAddAcquire(0) != 0; }
+
+	inline int channel() const { return m_channel; }
+	inline const QString &path() const { return m_path; }
+
+	inline void setLabel(const QString &label) { m_label = label; }
+	inline const QString takeLabel() { QString l = m_label; m_label.clear(); return l; }
+
+protected:
+	const QByteArray drain();
+
+private:
+	char *m_buffer;
+	int m_mask;
+	QAtomicInt m_head;
+	QAtomicInt m_tail;
+	QAtomicInt m_spilling;
+	QAtomicInt m_closed;
+	QMutex m_lock;
+	QTemporaryFile *m_spill;
+	int m_channel;
+	QString m_path;
+	QString m_label;
+};
+typedef QSharedPointer<OutputRing> OutputRingPtr;
+
+class QtBuilder : public QMainWindow, public QtBuilderBase, public EventSink
 {
 	Q_OBJECT
 
@@ -519,13 +1160,12 @@ public:
 
 	bool cancelled() const { return m_qtc->cancelled(); }
 	int maxDiskSpace() const;
-
-public slots:
-	void procOutput();
-	void procError();
-	void procLog();
+	void attach(const OutputRingPtr &ring);
+	void busEvent(const BusEvent &event);
 
 protected slots:
+	void pullOutput();
+	void flushOutput();
 	void process(bool start);
 	void processed();
 
@@ -539,7 +1179,7 @@ protected slots:
 	void setSourceDir(const QString &path, const QString &ver);
 	void setTargetDir(const QString &path, const QString &ver);
 
-	void nextBuild();
+	void nextBuild(const Modes &modes);
 	void diskOp(int to, bool start, int count);
 
 protected:
@@ -562,6 +1202,11 @@ private:
 	QFutureWatcher<void> m_loop;
 	QList<Modes *> m_opts;
 	QtCompile *m_qtc;
+	EventBus  *m_bus;
+
+	QList<OutputRingPtr> m_rings;
+	QMutex m_ringLock;
+	QTimer m_pull;
 
 	CopyProgress *m_cpy;
 	DiskSpaceBar *m_tgt;
@@ -589,13 +1234,21 @@ public:
 	const QString stdErr() { return readAllStandardError();  }
 
 	inline bool normalExit() const { return m_cancelled || exitCode() ==  NormalExit; }
+	qint64 processId() const;
 
 protected slots:
 	void cancel() { m_cancelled = true; }
 	void checkQuit();
+	void readOut();
+	void readErr();
 
 protected:
+	void attach(int channel, OutputRingPtr &ring, const QString &path = QString());
+	void killTree();
+
 	QtBuilder *m_bld;
+	OutputRingPtr m_out;
+	OutputRingPtr m_err;
 	bool m_cancelled;
 };
 
@@ -618,6 +1271,9 @@ public:
 	void setArgs(const QString &args);
 	void start(const QString &prog);
 	bool result();
+
+private:
+	QString m_args;
 };
 
 #endif // QTBUILDER_H
@@ -26,17 +26,58 @@
 #include "qmath.h"
 
 #include <QApplication>
+#include <QCryptographicHash>
+#include <QtConcurrentRun>
+#include <QThread>
 #include <QUuid>
 
 const bool qtBuilderConfigOnly = false;
 const bool qtBuilderUseTargets = false;
+const int  qtBuilderMatrixLanes = 0;	// ... variants built at the same time; 0 = one per 8 cores (thus 1 on most boxes)
+const bool qtBuilderPipelined	= true;	// ... publish the target files in the background while the next variant starts
+const bool qtBuilderPrefetch	= true;	// ... gather the next variant's build environment while the current one compiles
+const bool qtBuilderConfCache	= true;	// ... restore the configure output of identical earlier runs instead of running it again
+const bool qtBuilderProvenance	= true;	// ... skip variants whose target was built from the very same inputs
+const bool qtBuilderObjectCache	= true;	// ... compiler calls go through a shim that reuses objects of identical preprocessed sources
+const bool qtBuilderHostTools	= true;	// ... host tools are built once per toolchain and arch, later variants get a copy
+const bool qtBuilderGenCache	= true;	// ... moc/uic/rcc output of identical inputs is taken from earlier variants
+const int  qtBuilderLogTail		= 5;	// ... lines of the build log shown if a failed step has no recognizable error line
+const int  qtBuilderObjectCacheMb = 4096;	// ... least recently used objects are dropped beyond this size
+#ifndef _WIN32
+const QString qtBuilderToolchainEnv("/opt/qtbuilder/toolchain-env.sh"); // ... sourced with the arch argument; the counterpart to vcvarsall.bat
+#endif
 
 QtCompile::QtCompile(QtBuilder *main) : QtBuildState(main),
-	m_keepDisk(false), m_imdiskUnit(imdiskUnit)
+	m_master(NULL), m_owner(NULL), m_publisher(NULL), m_prefetcher(NULL), m_publishing(false), m_prefetching(false), m_lane(0), m_scratch(NULL)
 {
 	connect(main, SIGNAL(cancel()), this, SLOT(cancel()));
 }
 
+QtCompile::QtCompile(QtCompile *master, int lane, QtCompile *owner) : QtBuildState(master->parent()),
+	m_master(master), m_owner(owner), m_publisher(NULL), m_prefetcher(NULL), m_publishing(false), m_prefetching(false), m_lane(lane), m_scratch(NULL)
+{
+	connect(parent(), SIGNAL(cancel()), this, SLOT(cancel()));
+	//
+	// note: lanes emit from their own threads; the master just passes everything on (thus direct)!
+	//
+	connect(this, SIGNAL(log(const QString &, int)),				master, SLOT(laneLog(const QString &, int)),				Qt::DirectConnection);
+	connect(this, SIGNAL(log(const QString &, const QString &, int)),	master, SLOT(laneLog(const QString &, const QString &, int)),	Qt::DirectConnection);
+	connect(this, SIGNAL(progress(int, const QString &, qreal)),	master, SIGNAL(progress(int, const QString &, qreal)),	Qt::DirectConnection);
+	connect(this, SIGNAL(diskOp(int, bool, int)),					master, SIGNAL(diskOp(int, bool, int)),					Qt::DirectConnection);
+}
+
+QtCompile::~QtCompile()
+{
+	published();
+	prefetched(-1, -1, -1);
+	delete m_publisher;
+	delete m_prefetcher;
+
+	if (m_scratch)
+		m_scratch->unwatch();
+	delete m_scratch;
+}
+
 void QtCompile::sync()
 {
 	QtBuilder *b;
@@ -54,7 +95,56 @@ void QtCompile::sync()
 	m_version	= b->m_version;
 	m_libPath	= b->m_libPath;
 
+	m_trash.setRoot(m_libPath+SLASH+qtBuildTrash);
+
 	m_msvcBOpts = b->m_msvcBOpts;
+
+	if (qtBuilderPipelined && !m_owner && !m_publisher)
+	{
+		m_publisher = new QtCompile(m_master ? m_master : this, m_lane, this);
+	}
+	if (qtBuilderPrefetch && !m_owner && !m_prefetcher)
+	{
+		m_prefetcher = new QtCompile(m_master ? m_master : this, m_lane, this);
+	}
+	if (m_publisher)
+		m_publisher->sync();
+	if (m_prefetcher)
+		m_prefetcher->sync();
+
+	m_schema.clear();
+
+	if (m_master)
+		return;
+	//
+	// lanes are created here (i.e. in the gui thread) so they can use the main window for
+	// their processes; the cores are split among them, the scratch volume has to hold all
+	//
+	qDeleteAll(m_lanes);
+	m_lanes.clear();
+
+	int variants = 0;
+	FOR_CONST_KT(m_types)
+	FOR_CONST_JT(m_archs)
+	FOR_CONST_IT(m_msvcs)
+		variants += IT.value() && JT.value() && KT.value();
+
+	int lanes = qtBuilderMatrixLanes ? qtBuilderMatrixLanes : QThread::idealThreadCount()/8;
+	lanes = qBound(1, lanes, qMax(variants, 1));
+
+	for(int i = 1; i < lanes; i++)
+	{
+		QtCompile *lane = new QtCompile(this, i);
+		m_lanes.append(lane);
+		lane->sync();
+	}
+
+	int cores = qMax(1, m_bopts.value(Cores)/lanes);
+	m_bopts[Cores] = cores;
+	m_bopts[RamDisk] *= lanes;
+
+	FOR_CONST_IT(m_lanes)
+		(*IT)->m_bopts[Cores] = cores;
 }
 
 void QtCompile::loop()
@@ -65,82 +155,240 @@ void QtCompile::loop()
 		return;
 	}
 
-	Modes m;
-	m.unite(m_msvcs);
-	m.unite(m_archs);
-	m.unite(m_types);
-	FOR_IT(m)IT.value()=0;
-
-	int msvc, arch, type;
-	FOR_CONST_KT(m_types)
-	FOR_CONST_JT(m_archs)
-	FOR_CONST_IT(m_msvcs)
+	FOR_CONST_IT(m_lanes)
+	if (!(*IT)->createTemp())
 	{
-		if (!IT.value()||!JT.value()||!KT.value())
-			continue;
+		state = ErrCreateTemp;
+		goto end;
+	}
 
-		msvc = IT.key();
-		arch = JT.key();
-		type = KT.key();
+	//
+	// the sources don't change during a run; the fingerprint is shared with all lanes. it reads
+	// every source file, thus it is only taken if one of the caches keyed on it is enabled.
+	//
+	m_sources.clear();
+	if (qtBuilderConfCache || qtBuilderProvenance || qtBuilderHostTools)
+		m_sources = ConfigureCache::fingerprint(m_source);
 
-		m[msvc]=m[arch]=m[type]=true;
-		emit current(m);
-		m_target.clear();
+	m_running.clear();
+	m_pending.clear();
+	m_halt = 0;
+	{
+		Variant v;
+		FOR_CONST_KT(m_types)
+		FOR_CONST_JT(m_archs)
+		FOR_CONST_IT(m_msvcs)
+		{
+			if (!IT.value()||!JT.value()||!KT.value())
+				continue;
 
-		for	  (state;
-			   state < Finished;
-			   state+= 1)
-		switch(state)
+			v.msvc = IT.key();
+			v.arch = JT.key();
+			v.type = KT.key();
+			m_pending.enqueue(v);
+		}
+	}
+	{
+		QList<QFuture<void> > lanes;
+		FOR_CONST_IT(m_lanes)
 		{
-		case CreateTarget:	if (!createTgt(msvc,type,arch)) state+= Error; break;
-		case CopySource:	if (!copySource	 ()				 ) state+= Error; break;
-		case Prepare:		if (!prepare	 (msvc,type,arch)) state+= Error; break;
-		case ConfClean:		if (!confClean	 ()				 ) state+= Error; break;
-		case Configure:		if (!configure	 (msvc,type)	 ) state+= Error; break;
-		case Compiling:		if (!compiling	 ()				 ) state+= Error; break;
-		case Cleaning:		if (!cleaning	 ()				 ) state+= Error; break;
-		case Finalize:		if (!finalize	 ()				 ) state+= Error; break;
-		case CopyTarget:	if (!copyTarget	 ()				 ) state+= Error; break;
-		default:															 continue;
+			(*IT)->state = Started;
+			lanes.append(QtConcurrent::run(*IT, &QtCompile::drain));
 		}
 
-		m[msvc]=m[arch]=m[type]=false;
-		if	(state > Finished)
-			 goto end;
-		else state = Started;
+		drain();
+
+		FOR_IT(lanes)
+			(*IT).waitForFinished();
 	}
+	//
+	// the first failing lane decides about the overall result (unless cancelled anyway)
+	//
+	FOR_CONST_IT(m_lanes)
+		if (state <= Finished && (*IT)->state > Finished)
+			state = (int)(*IT)->state;
 
 	end:
-	emit current(m);
+	emit current(modes(false));
 	if (!removeTemp())
 		state = ErrRemoveTemp;
 
 	QMutexLocker l(&mutex); // ... avoid watcher "finished" during close event signal reconnection!
 }
 
-bool QtCompile::createTemp()
+void QtCompile::drain()
+{
+	QtCompile *master = m_master ? m_master : this;
+
+	Variant v;
+	while(master->nextVariant(v))
+		if (!build(v.msvc, v.arch, v.type))
+			master->m_halt = 1; // ... running variants are finished, no new ones are started.
+
+	prefetched(-1, -1, -1); // ... whatever is left over is thrown away.
+
+	if (!published() && !cancelled())
+	{
+		state = ErrCopyTarget;
+		master->m_halt = 1;
+	}
+}
+
+bool QtCompile::build(int msvc, int arch, int type)
 {
-	log("Build step", "Creating temp infrastructure ...", AppInfo);
+	QtCompile *master = m_master ? m_master : this;
+
+	master->running(msvc, arch, type, true);
+	m_target.clear();
+	m_provenance.clear();
+
+	m_variant.msvc = msvc;
+	m_variant.arch = arch;
+	m_variant.type = type;
+
+	if (qtBuilderProvenance && upToDate(msvc, arch, type))
+	{
+		master->running(msvc, arch, type, false);
+		return true;
+	}
 
-	m_drive = driveLetter();
-	if (m_drive.isEmpty())
+	for	  (state;
+		   state < Finished;
+		   state+= 1)
+	switch(state)
 	{
-		log("No drive letter available", Critical);
+	case CreateTarget:	if (!createTgt(msvc,type,arch)) state+= Error; break;
+	case CopySource:	if (!copySource	 ()				 ) state+= Error; break;
+	case Prepare:		if (!prepare	 (msvc,type,arch)) state+= Error; break;
+	case ConfClean:		if (!confClean	 ()				 ) state+= Error; break;
+	case Configure:		if (!configure	 (msvc,type)	 ) state+= Error; break;
+	case Compiling:		if (!compiling	 ()				 ) state+= Error; break;
+	case Cleaning:		if (!cleaning	 ()				 ) state+= Error; break;
+	case Finalize:		if (!finalize	 ()				 ) state+= Error; break;
+	case CopyTarget:	if (!publish	 ()				 ) state+= Error; break;
+	default:															 continue;
+	}
+
+	master->running(msvc, arch, type, false);
+	if	(state > Finished)
+	{
+		lastError();
 		return false;
 	}
+	state = Started;
+	return true;
+}
+
+void QtCompile::lastError()
+{	//
+	// only the last frames of the (compressed) build log are read for this.
+	//
+	if ((state != ErrConfigure && state != ErrCompiling) || m_target.isEmpty())
+		return;
+
+	CALL_QUEBLK(parent(), flushOutput);
+
+	LogReader reader;
+	if (!reader.open(logFile(m_target)))
+		return;
 
-	if (!attachImdisk(m_drive))
+	QString error = reader.lastError();
+	if (!error.isEmpty())
 	{
-		log("Couldn't create RAM disk:", QString("\"%1:\"").arg(m_drive), Critical);
+		log("Last build error:", error, Critical);
+		return;
+	}
+	QStringList tail = reader.tail(qtBuilderLogTail); // ... no error line recognized; the output the step ended with.
+	if (!tail.isEmpty())
+		log("Last build output:", tail.join(_CRLF), Critical);
+}
+
+bool QtCompile::nextVariant(Variant &v)
+{
+	QMutexLocker l(&m_queue);
+	if (m_halt || cancelled() || m_pending.isEmpty())
+		return false;
+
+	v = m_pending.dequeue();
+	return true;
+}
+
+bool QtCompile::peekVariant(Variant &v)
+{
+	QMutexLocker l(&m_queue);
+	if (m_halt || cancelled() || m_pending.isEmpty())
 		return false;
+
+	v = m_pending.head();
+	return true;
+}
+
+void QtCompile::running(int msvc, int arch, int type, bool active)
+{
+	Modes m;
+	{	QMutexLocker l(&m_queue);
+		int add = active ? 1 : -1;
+		m_running[msvc] += add;
+		m_running[arch] += add;
+		m_running[type] += add;
+		m = modes(true);
 	}
+	if (active)
+		emit current(m);
+	else if (!m.values().contains(true))
+		m_scratch->shrink(); // ... only with no variant in progress.
+}
 
-	m_drive += ":";
+const Modes QtCompile::modes(bool active) const
+{
+	Modes m;
+	m.unite(m_msvcs);
+	m.unite(m_archs);
+	m.unite(m_types);
+	FOR_IT(m)IT.value() = active && m_running.value(IT.key()) > 0;
+	return m;
+}
+
+void QtCompile::laneLog(const QString &msg, int type)
+{
+	if (QtCompile *lane = qobject_cast<QtCompile *>(sender()))
+		 emit log(QString("#%1 %2").arg(lane->m_lane).arg(msg), type);
+}
+
+void QtCompile::laneLog(const QString &msg, const QString &text, int type)
+{
+	if (QtCompile *lane = qobject_cast<QtCompile *>(sender()))
+		 emit log(QString("#%1 %2").arg(lane->m_lane).arg(msg), text, type);
+}
+
+bool QtCompile::createTemp()
+{
+	QString lane = m_lane ? QString("-%1").arg(m_lane) : QString();
+	if (m_master)
+	{
+		m_drive = m_master->m_drive;
+	}
+	else
+	{
+		log("Build step", "Creating temp infrastructure ...", AppInfo);
+
+		delete m_scratch;
+		m_scratch = ScratchVolume::create(this);
+
+		if (!m_scratch->attach(m_bopts.value(RamDisk)))
+		{
+			log("Couldn't create scratch volume:", m_scratch->name(), Critical);
+			return false;
+		}
+
+		m_drive = m_scratch->root();
+		m_scratch->watch();
+	}
 	if (!QDir(m_build).entryList(QDir::NoDotAndDotDot).isEmpty())
 		log("Build folder not empty", "Existing content might get overwritten!", Warning);
 
-	m_btemp = m_drive+SLASH+qtBuildTemp;
-	m_build = m_drive+SLASH+qtBuildMain;
+	m_btemp = m_drive+SLASH+qtBuildTemp+lane;
+	m_build = m_drive+SLASH+qtBuildMain+lane;
 
 	if (!QDir(m_btemp).exists() && !QDir().mkpath(m_btemp))
 	{
@@ -152,20 +400,33 @@ bool QtCompile::createTemp()
 		return false;
 	}
 
-	QFile(logFile(m_build)).remove();
+	LogWriter::instance()->flush(true); // ... a kept build folder's log starts over.
+	QStringList logs = FramedLog::files(logFile(m_build));
+	FOR_CONST_IT(logs)
+		QFile(*IT).remove();
 	clearPath(m_build+"/lib");
 
+	if (m_master)
+		return true; // ... the manifest is not shared; lanes scan their sources the plain way.
+
+	m_manifest.load(m_drive+SLASH+qtBuildManif, m_source);
+
 	emit tempDrive(m_build);
 	return true;
 }
 
 bool QtCompile::removeTemp()
 {
-	if (m_keepDisk)
+	m_manifest.clear();
+	if (!m_scratch)
+		return true;
+
+	m_scratch->unwatch();
+	if (m_scratch->kept())
 		return true;
 
 	log("Build step", "Removing temp infrastructure ...", AppInfo);
-	return removeImdisk(false, false);
+	return m_scratch->detach(false);
 }
 
 bool QtCompile::createTgt(int msvc, int type, int arch)
@@ -189,6 +450,10 @@ bool QtCompile::createTgt(int msvc, int type, int arch)
 	{
 		log("Target folder already mounted:", QString("%1 -> %2").arg(bldNat, tgtNat), Warning);
 	}
+	else if (dir.exists() && m_trash.trash(m_target))
+	{
+		log("Target directory moved to trash:", tgtNat);
+	}
 	else if (dir.exists())
 	{
 		log("Clearing target folder:", tgtNat);
@@ -226,14 +491,21 @@ bool QtCompile::copySource()
 	log("Build step", "Copying source files ...", AppInfo);
 	QString native = QDir::toNativeSeparators(m_build);
 
-	m_dirFilter = sfilter;
-	m_extFilter = ffilter;
+	m_filter.compile(sfilter, ffilter);
 
 	log("Copying contents to:", native);
 
 	int  count;
 	if(!(count = copyFolder(Source, Build)))
 		 log("Couldn't copy contents to:", native, Critical);
+	else if (!cancelled() && m_manifest.isLoaded())
+	{
+		log("Source manifest:", QString("%1 folders re-used, %2 re-scanned")
+			.arg(m_manifest.reused()).arg(m_manifest.scanned()));
+
+		if (!m_manifest.save())
+			log("Couldn't save source manifest:", QDir::toNativeSeparators(m_drive+SLASH+qtBuildManif), Warning);
+	}
 
 	log("Total files copied:", QString::number(count));
 	return count;
@@ -262,8 +534,7 @@ bool QtCompile::copyTarget()
 	log("Activating file compression:", native, Warning);
 	InlineProcess(this, "compact", QString("/c /i %1").arg(native));
 
-	m_dirFilter = sfilter+tfilter;
-	m_extFilter	= cfilter;
+	m_filter.compile(sfilter+tfilter, cfilter);
 
 	log("Copying contents to:", native);
 
@@ -271,13 +542,137 @@ bool QtCompile::copyTarget()
 	if(!(count = copyFolder(Build, Target, false, true)))
 		 log("Couldn't copy contents to:", native, Critical);
 
-	QFile(logFile(m_build)).copy(logFile(m_target));
+	LogWriter::instance()->flush(true);
+	QStringList from = FramedLog::files(logFile(m_build));
+	QStringList to	 = FramedLog::files(logFile(m_target));
+	for (int i = 0; i < from.count(); i++) // ... root files aren't copied above, the log and its index are.
+		QFile(from.at(i)).copy(to.at(i));
 	removeDir(m_target+"/%SystemDrive%");
 
+	if (count && !cancelled() && !m_provenance.isEmpty())
+		writeTextFile(m_target+SLASH+qtBuildProv, m_provenance); // ... only a complete target gets one.
+
 	log("Total files copied:", QString::number(++count));
 	return count;
 }
 
+bool QtCompile::publish()
+{	//
+	// the finished build tree is moved aside on the scratch volume (thus instantly) and
+	// copied to the target by the publisher, while the next variant already starts with
+	// a fresh build folder; the disk space bar shows the whole volume, i.e. both trees.
+	//
+	CALL_QUEBLK(parent(), flushOutput); // ... the build log goes along with the build folder.
+
+	if (!m_publisher || qtBuilderConfigOnly)
+		return copyTarget();
+
+	if (!published()) // ... one publish per lane at a time, to bound the scratch space.
+		return false;
+
+	QString aside = m_drive+SLASH+qtBuildPubl+(m_lane ? QString("-%1").arg(m_lane) : QString());
+	if (QDir(aside).exists())
+		TrashBin::removeTree(aside);
+
+	if (!QDir().rename(m_build, aside))
+		return copyTarget();
+
+	log("Build step", "Publishing target files in background ...", AppInfo);
+
+	m_publisher->state	= Started;
+	m_publisher->m_build  = aside;
+	m_publisher->m_target = m_target;
+	m_publisher->m_provenance = m_provenance;
+	m_publish = QtConcurrent::run(m_publisher, &QtCompile::publishing);
+	m_publishing = true;
+
+	if (!QDir().mkpath(m_build))
+	{
+		log("Couldn't create build folder:", QDir::toNativeSeparators(m_build), Critical);
+		return false;
+	}
+	return true;
+}
+
+bool QtCompile::published()
+{
+	if (!m_publishing) // ... i.e. nothing published yet.
+		return true;
+
+	m_publish.waitForFinished();
+	bool result = m_publish.result();
+
+	m_publish = QFuture<bool>();
+	m_publishing = false;
+	return result;
+}
+
+bool QtCompile::publishing()
+{
+	bool result = copyTarget();
+
+	TrashBin::removeTree(m_build);
+	return result;
+}
+
+void QtCompile::prefetch()
+{	//
+	// while jom is busy, the next variant's vcvarsall environment (and the configure options
+	// if not known yet) is gathered at low priority; it is handed over by prepare() only if
+	// this lane actually gets that variant, otherwise (or if cancelled) it is thrown away.
+	//
+	QtCompile *master = m_master ? m_master : this;
+	if (!m_prefetcher || m_prefetching || !master->peekVariant(m_next))
+		return;
+
+	m_prefetcher->state	   = Started;
+	m_prefetcher->m_schema = m_schema;
+	m_prefetcher->m_btemp  = m_btemp;
+	m_prefetcher->m_target = m_target; // ... linked to the lane's build folder now; see prefetching().
+	m_prefetch = QtConcurrent::run(m_prefetcher, &QtCompile::prefetching, m_next.msvc, m_next.arch, m_next.type);
+	m_prefetching = true;
+}
+
+bool QtCompile::prefetched(int msvc, int arch, int type)
+{
+	if (!m_prefetching) // ... i.e. nothing prefetched.
+		return false;
+
+	m_prefetch.waitForFinished();
+	bool result = m_prefetch.result();
+	m_prefetch = QFuture<bool>();
+	m_prefetching = false;
+
+	if (m_schema.isEmpty())
+		m_schema = m_prefetcher->m_schema;
+
+	if (!result || cancelled() ||
+		m_next.msvc != msvc || m_next.arch != arch || m_next.type != type)
+		return false;
+
+	m_env = m_prefetcher->m_env;
+	log("Build environment prefetched", QString("%1 %2").arg(qMakeS.at(msvc), m_msvcBOpts.at(arch)));
+	return true;
+}
+
+bool QtCompile::prefetching(int msvc, int arch, int type)
+{	//
+	// if the schema isn't known yet, configure -help runs in the target folder handed over
+	// (the lane's build folder, thus with the sources); only then the target is set to the
+	// next variant's one, which its environment refers to (no files are touched there).
+	//
+	QThread::currentThread()->setPriority(QThread::LowestPriority);
+
+	optionSchema();
+
+	QString native;
+	m_target = targetDir(msvc, arch, type, native);
+	bool result = !cancelled() && setEnvironment(msvc, arch);
+
+	QThread::currentThread()->setPriority(QThread::NormalPriority);
+	return result;
+}
+
 bool QtCompile::prepare(int msvc, int type, int arch)
 {
 	if (!checkDir(Source))
@@ -313,11 +708,10 @@ bool QtCompile::prepare(int msvc, int type, int arch)
 		}
 	}
 
-	QString vcVars = QDir::toNativeSeparators(QString("call \"%1\" %2")
-		.arg(m_msvcBOpts.at(msvc)+msVisualCpp+msVcVarsAll).arg(m_msvcBOpts.at(arch)));
+	QString vcVars = vcVarsCall(msvc, arch);
 
 	bool result = true;
-	if(!(result = setEnvironment(vcVars, makeSpec)))
+	if(!(result = prefetched(msvc, arch, type) || setEnvironment(msvc, arch)))
 	{
 		finalize();
 		return false;
@@ -343,12 +737,11 @@ bool QtCompile::confClean()
 	// ... seems to be better to not use confclean results, i.e. if the prev. build was messed up.
 }
 
-bool QtCompile::configure(int msvc, int type)
+const QString QtCompile::configOptions(int msvc, int type, bool check)
 {
-	log("Build step", QString("Running %1 ...").arg(qtConfigure), AppInfo);
-
 	QStringList  o = globals+switches+features+plugins+exclude;
-	checkOptions(o);
+	if (check)
+		checkOptions(o);
 
 	QStringList  c;
 	FOR_CONST_IT(m_confs)
@@ -356,6 +749,14 @@ bool QtCompile::configure(int msvc, int type)
 
 	QString qtConfig =c.join("-and");
 	qtConfig += QString(" %1 %2 %3").arg(qtOpts.at(msvc), qtOpts.at(type), o.join(" "));
+	return	qtConfig;
+}
+
+bool QtCompile::configure(int msvc, int type)
+{
+	log("Build step", QString("Running %1 ...").arg(qtConfigure), AppInfo);
+
+	QString qtConfig = configOptions(msvc, type, true);
 
 	if (false)
 	{	BuildProcess proc(this);
@@ -364,10 +765,37 @@ bool QtCompile::configure(int msvc, int type)
 		return proc.result();
 	}
 
-	BuildProcess proc(this);
-	proc.setArgs(qtConfig);
-	proc.start(qtConfigure);
-	return proc.result();
+	QByteArray key;
+	QString cache;
+	if (qtBuilderConfCache)
+	{
+		key = ConfigureCache::key(qtConfig, qMakeS.at(msvc), m_env, sources());
+		cache = QString("%1/%2/configure-%3.archive").arg(m_libPath, qtBuildCache, QString(key));
+
+		int count;
+		if (ConfigureCache::restore(cache, m_build, count))
+		{
+			log("Configure results restored:", QString("%1 files from cache").arg(count));
+			return true;
+		}
+	}
+
+	QDateTime since = QDateTime::currentDateTime();
+	bool result;
+	{	BuildProcess proc(this);
+		proc.setArgs(qtConfig);
+		proc.start(qtConfigure);
+		result = proc.result();
+	}
+
+	int count;
+	if (qtBuilderConfCache && result && !cancelled())
+	{
+		if (ConfigureCache::store(cache, m_build, since, count))
+			 log("Configure results cached:", QString("%1 files").arg(count));
+		else log("Couldn't cache configure results:", QDir::toNativeSeparators(cache), Warning);
+	}
+	return result;
 }
 
 bool QtCompile::compiling()
@@ -381,18 +809,26 @@ bool QtCompile::compiling()
 	if (msBuildTool.contains("jom", Qt::CaseInsensitive))
 		args = QString("/J %1 ").arg(m_bopts.value(Cores));
 
+	prefetch();
+
+	if ((qtBuilderHostTools || qtBuilderGenCache) && !hostTools(args))
+		return false;
+	if (state != Compiling)
+		return true;
+
+	bool result = true;
 	if(!qtBuilderUseTargets)
 	{
 		BuildProcess proc(this);
 		proc.setArgs(args);
 		proc.start(msBuildTool);
-		return proc.result();
+		result = proc.result();
 	}
 	//
 	// TODO: this needs to go into the config sections, as it is of course connected
 	// with the pre-defined configure options (whatever they are good for anyway)!!!
 	//
-	FOR_CONST_IT(targets)
+	else FOR_CONST_IT(targets)
 	{
 		if (state == Compiling)
 		{	BuildProcess proc(this);
@@ -402,9 +838,112 @@ bool QtCompile::compiling()
 				 return false;
 		}	else return true;
 	}	// note: if state was set to cancelled during processing, the local result is still "true" (since there was no process error!)
+
+	if (qtBuilderGenCache && result && state == Compiling)
+		storeGenerated();
+	return result;
+}
+
+bool QtCompile::hostTools(const QString &args)
+{	//
+	// the host tools go first; files restored from the generated cache afterwards are newer
+	// than the tools and their inputs, the main build then takes them as being up to date.
+	//
+	// the tools don't depend on the library type; their output of an earlier variant with the
+	// same toolchain and arch is written back instead, newer than its sources, so the tool
+	// targets are up to date and not even started.
+	//
+	QString cache;
+	int count = 0;
+	if (qtBuilderHostTools)
+	{
+		cache = QString("%1/%2/hosttools-%3.archive").arg(m_libPath, qtBuildCache, QString(hostToolsKey()));
+		if (ConfigureCache::restore(cache, m_build, count))
+			log("Host tools restored:", QString("%1 files from cache").arg(count));
+		else count = 0;
+	}
+	if (!count)
+	{
+		QDateTime since = QDateTime::currentDateTime();
+		{	BuildProcess proc(this);
+			proc.setArgs(args+htools.join(" "));
+			proc.start(msBuildTool);
+			if (!proc.result())
+				return false;
+		}
+		if (state != Compiling)
+			return true;
+
+		if (qtBuilderHostTools)
+		{
+			if (ConfigureCache::store(cache, m_build, since, count, hpaths))
+				 log("Host tools cached:", QString("%1 files").arg(count));
+			else log("Couldn't cache host tools:", QDir::toNativeSeparators(cache), Warning);
+		}
+	}
+	if (!qtBuilderGenCache)
+		return true;
+
+	QString root = QString("%1/%2/generated").arg(m_libPath, qtBuildCache);
+	count = GeneratedCache::seed(root, m_build, m_version);
+	if (count)
+		log("Generated files restored:", QString("%1 files from cache").arg(count));
 	return true;
 }
 
+const QByteArray QtCompile::hostToolsKey()
+{	//
+	// the tools don't depend on the library type, thus only the tool sources (by the source
+	// fingerprint), the toolchain and the compiler/linker settings of the tool Makefiles go
+	// into the key; the Makefiles' header (with the time qmake ran) is left out, as are the
+	// build and target paths (the target differs by type, the build folder by lane).
+	//
+	QCryptographicHash h(QCryptographicHash::Md5);
+	h.addData(qMakeS.at(m_variant.msvc).toUtf8());
+	h.addData(vsOpts.at(m_variant.arch).toUtf8());
+	h.addData(m_version.toUtf8());
+	h.addData(sources());
+
+	QList<QPair<QString, QString> > paths;
+	paths << qMakePair(QDir::toNativeSeparators(m_target), QString("$(TARGET_DIR)"))
+		  << qMakePair(m_target, QString("$(TARGET_DIR)"))
+		  << qMakePair(QDir::toNativeSeparators(m_build), QString("$(BUILD_DIR)"))
+		  << qMakePair(m_build, QString("$(BUILD_DIR)"));
+
+	QRegExp settings("^(DEFINES|CFLAGS|CXXFLAGS|INCPATH|LFLAGS|LIBS|LIBAPP|CC|CXX|LINK|LIB)\\s*=");
+	FOR_CONST_IT(htools)
+	{
+		QString dir = QString("%1/src/tools/%2").arg(m_build, QString(*IT).remove("sub-").remove("tools-"));
+		QFileInfoList files = QDir(dir).entryInfoList(QStringList() << "Makefile*", QDir::Files, QDir::Name);
+		FOR_CONST_JT(files)
+		{
+			QFile file((*JT).absoluteFilePath());
+			if (!file.open(QIODevice::ReadOnly))
+				continue;
+
+			QString text = QString::fromLocal8Bit(file.readAll());
+			text.replace(QRegExp("\\\\[ \\t]*\\r?\\n"), " "); // ... continued lines
+			FOR_CONST_KT(paths)
+				text.replace((*KT).first, (*KT).second, Qt::CaseInsensitive);
+
+			h.addData((*JT).fileName().toUtf8());
+			QStringList lines = text.split(QRegExp("[\\r\\n]+"), QString::SkipEmptyParts);
+			FOR_CONST_LT(lines)
+				if (settings.indexIn(*LT) == 0)
+					h.addData((*LT).simplified().toUtf8());
+		}
+	}
+	return h.result().toHex();
+}
+
+void QtCompile::storeGenerated()
+{
+	QString root = QString("%1/%2/generated").arg(m_libPath, qtBuildCache);
+	int count = GeneratedCache::store(root, m_build, m_version);
+	if (count)
+		log("Generated files cached:", QString("%1 files").arg(count));
+}
+
 bool QtCompile::cleaning()
 {
 return true;
@@ -434,29 +973,69 @@ bool QtCompile::finalize()
 
 	log("Qt build done", text.toUpper(), Elevated);
 
+	if (qtBuilderProvenance && state == Finalize)
+		m_provenance = provenance(m_variant.msvc, m_variant.arch, m_variant.type);
+
+	if (qtBuilderObjectCache)
+	{
+		log("Object cache:", ObjectCache::statistics(m_btemp+"/ccstats", true));
+		ObjectCache::trim(QString("%1/%2/objects").arg(m_libPath, qtBuildCache), qtBuilderObjectCacheMb);
+	}
+
 	QFile(m_target+SLASH+msBuildTool).remove();
 	return true;
 }
 
-void QtCompile::checkOptions(QStringList &opts)
+const OptionSchema &QtCompile::optionSchema()
 {
-	QString options;
-	{	BuildProcess proc(this, true);
-		proc.setArgs("-help");
-		proc.start(qtConfigure);
+	if (!m_schema.isEmpty()) // ... same sources for all variants, thus the same options.
+		return m_schema;
 
-		proc.result();
-		options = proc.stdOut();
-	}
-	if (options.isEmpty())
-		return;
+	QByteArray key = OptionSchema::key(m_source+SLASH+qtConfigure, m_version);
+	QString cache = QString("%1/%2/configure-%3.schema").arg(m_libPath, qtBuildCache, QString(key));
 
-	options.append("-confirm-license");
-	// ... at least for 4.x this is not contained in the help output!
+	if (m_schema.load(cache, key))
+		return m_schema;
 
-	QStringList o;
-	QString opt;
+	BuildProcess proc(this, true);
+	proc.setArgs("-help");
+	proc.start(qtConfigure);
+
+	proc.result();
+	m_schema.parse(proc.stdOut());
+
+	if (!cancelled() && !m_schema.isEmpty() && !m_schema.save(cache))
+		log("Couldn't cache configure options:", QDir::toNativeSeparators(cache), Warning);
+	return m_schema;
+}
+
+const QString QtCompile::vcVarsScript(int msvc) const
+{
+#ifdef _WIN32
+	return m_msvcBOpts.at(msvc)+msVisualCpp+msVcVarsAll;
+#else
+	Q_UNUSED(msvc);
+	return qtBuilderToolchainEnv;
+#endif
+}
+
+const QString QtCompile::vcVarsCall(int msvc, int arch) const
+{
+#ifdef _WIN32
+	return QDir::toNativeSeparators(QString("call \"%1\" %2")
+		.arg(vcVarsScript(msvc)).arg(m_msvcBOpts.at(arch)));
+#else
+	return QString(". \"%1\" %2").arg(vcVarsScript(msvc)).arg(m_msvcBOpts.at(arch));
+#endif
+}
 
+void QtCompile::checkOptions(QStringList &opts)
+{
+	const OptionSchema &schema = optionSchema();
+	if (schema.isEmpty())
+		return;
+
+	QString opt;
 	auto  it  = opts.begin();
 	while(it != opts.end())
 	{
@@ -467,14 +1046,7 @@ void QtCompile::checkOptions(QStringList &opts)
 			continue;
 		}
 
-		o = opt.split("-");
-		QString test;
-
-		int count = qMin(o.count(), 2); // several options are variable, but at least the 1st 2 parts of the option string is static (is it??)
-		for(int i = 0; i < count; i++)
-			test += o.at(i);
-
-		if (!options.contains(test, Qt::CaseInsensitive))
+		if (!schema.accepts(opt))
 		{
 			it = opts.erase(it);
 			log("Unknown option removed:", opt, Warning);
@@ -483,9 +1055,9 @@ void QtCompile::checkOptions(QStringList &opts)
 	}
 }
 
-bool QtCompile::setEnvironment(const QString &vcVars, const QString &mkSpec)
+const QProcessEnvironment QtCompile::baseEnvironment()
 {
-	m_env.clear();
+	QProcessEnvironment env;
 	//
 	//	initial steps to create a clean build environment:
 	//
@@ -521,41 +1093,35 @@ bool QtCompile::setEnvironment(const QString &vcVars, const QString &mkSpec)
 					lines +=  (*JT);
 			value = lines.join(";");
 		}
-		m_env.insert(key, value);
+		env.insert(key, value);
 	}
+	return env;
+}
+
+bool QtCompile::setEnvironment(int msvc, int arch)
+{
+	QString vcVars = vcVarsCall(msvc, arch);
+	QString mkSpec = qMakeS.at(msvc);
+	m_env = baseEnvironment();
 
+	QString value, key;
+	QStringList parts, lines;
 	QString tgtNat = QDir::toNativeSeparators(m_target);
 	QString tmpNat = QDir::toNativeSeparators(m_btemp);
 	//
-	//	create cmd script to set & gather the msvc build environment
+	//	the captured toolchain environment is cached by the script call, the script
+	//	itself and the (filtered) base path; only a miss runs the toolchain script
 	//
-	QString  anchor = QUuid::createUuid().toString();
-	QString  script, native;
-	{	QString cmd;
-				cmd += QString("%1\r\n"		 ).arg(vcVars);
-				cmd += QString("#echo %1\r\n").arg(anchor);
-				cmd += QString("set"		 );
-
-		script = m_btemp+"/vcvars.cmd";
-		native = QDir::toNativeSeparators(script);
+	QByteArray hash = EnvironmentCache::key(vcVars, vcVarsScript(msvc), m_env.toStringList());
+	QString cache = QString("%1/%2/environment-%3.env").arg(m_libPath, qtBuildCache, QString(hash));
 
-		if (!writeTextFile(script, cmd))
-		{
-			log("Failed to write environment script:", native, Critical);
-			return false;
-		}
-	}
-	//
-	//	collect the build environment by executing
-	//	the above script and parsing the output...
-	//	using a "clean" version of the path value!
-	//
-	BuildProcess prc(this, true);
-	prc.start(script);
-	if (!prc.result())
+	if (!EnvironmentCache::load(cache, hash, lines))
 	{
-		log("Failed to get build environment:", native, Critical);
-		return false;
+		if (!captureEnvironment(vcVars, lines))
+			return false;
+
+		if (!cancelled() && !EnvironmentCache::save(cache, hash, lines))
+			log("Couldn't cache build environment:", QDir::toNativeSeparators(cache), Warning);
 	}
 	//
 	//	additional modifications during parsing...
@@ -569,8 +1135,6 @@ bool QtCompile::setEnvironment(const QString &vcVars, const QString &mkSpec)
 	//  - the TEMP/TMP values are set to the temp dir
 	//	  (to buffer temporary files from cl/link.exe)
 	//
-	parts = prc.stdOut().split(anchor);
-	lines = parts.last().split(_CRLF);
 	FOR_CONST_IT(lines)
 	{
 		value = *IT;
@@ -607,6 +1171,79 @@ bool QtCompile::setEnvironment(const QString &vcVars, const QString &mkSpec)
 		m_env.insert("QTDIR",	  tgtNat);
 		m_env.insert("QMAKESPEC", tgtNat+"\\mkspecs\\"+mkSpec);
 	}
+	if (qtBuilderObjectCache)
+	{
+		QString shim = QString("%1/%2/ccwrap" ).arg(m_libPath, qtBuildCache);
+		QString root = QString("%1/%2/objects").arg(m_libPath, qtBuildCache);
+		QString error;
+
+		if (ObjectCache::install(shim, error))
+			ObjectCache::environment(m_env, shim, root, m_btemp+"/ccstats");
+		else
+			log("Couldn't install compiler shim:", error, Warning);
+	}
+	return true;
+}
+
+bool QtCompile::captureEnvironment(const QString &vcVars, QStringList &lines)
+{
+	//
+	//	create a script to set & gather the toolchain build environment
+	//
+	QString  anchor = QUuid::createUuid().toString();
+	QString  script, native;
+	{	QString cmd;
+#ifdef _WIN32
+				cmd += QString("%1\r\n"		 ).arg(vcVars);
+				cmd += QString("#echo %1\r\n").arg(anchor);
+				cmd += QString("set"		 );
+
+		script = m_btemp+"/vcvars.cmd";
+#else
+				cmd += QString("%1\n"		 ).arg(vcVars);
+				cmd += QString("echo %1\n"	 ).arg(anchor);
+				cmd += QString("env"		 );
+
+		script = m_btemp+"/vcvars.sh";
+#endif
+		native = QDir::toNativeSeparators(script);
+
+		if (!writeTextFile(script, cmd))
+		{
+			log("Failed to write environment script:", native, Critical);
+			return false;
+		}
+	}
+	//
+	//	collect the build environment by executing
+	//	the above script and parsing the output...
+	//	using a "clean" version of the path value!
+	//
+	//	the script runs in the temp folder, since the
+	//	target folder may not exist yet (prefetching)
+	//
+	BuildProcess prc(this, true);
+	prc.setWorkingDirectory(m_btemp);
+#ifdef _WIN32
+	prc.start(script);
+#else
+	prc.start("sh "+script);
+#endif
+	bool result = prc.result() && prc.error() != QProcess::FailedToStart;
+	QString out = prc.stdOut();
+
+	if (!result || !out.contains(anchor))
+	{	// ... a failed prefetch falls back to the regular capture, thus no critical error.
+		log("Failed to get build environment:", native, m_owner ? Warning : Critical);
+		return false;
+	}
+
+	lines = out.split(anchor).last().split(QRegExp("[\r\n]+"), QString::SkipEmptyParts);
+	if (!EnvironmentCache::valid(lines))
+	{
+		log("Incomplete build environment:", native, m_owner ? Warning : Critical);
+		return false;
+	}
 	return true;
 }
 
@@ -665,7 +1302,49 @@ bool QtCompile::writeTextFile(const QString &filePath, const QString &text)
 	}
 }
 
+const QString QtCompile::provenance(int msvc, int arch, int type)
+{	//
+	// the inputs of a variant: the sources (every file, see ConfigureCache::fingerprint), the
+	// configure options (as defined, before any validation) and the toolchain environment
+	// (by its cache key; no script is run here)
+	//
+	QStringList p;
+	p << QString("version=%1").arg(m_version);
+	p << QString("variant=%1/%2/%3").arg(qMakeS.at(msvc), m_msvcBOpts.at(arch), qtOpts.at(type));
+	p << QString("sources=%1").arg(QString(sources()));
+	p << QString("options=%1").arg(QString(QCryptographicHash::hash(configOptions(msvc, type, false).toUtf8(), QCryptographicHash::Md5).toHex()));
+	p << QString("toolchain=%1").arg(QString(EnvironmentCache::key(vcVarsCall(msvc, arch), vcVarsScript(msvc), baseEnvironment().toStringList())));
+	return p.join(___LF)+___LF;
+}
+
+bool QtCompile::upToDate(int msvc, int arch, int type)
+{
+	QString native;
+	QString target = targetDir(msvc, arch, type, native);
+
+	QFile file(target+SLASH+qtBuildProv);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	QStringList last = QString(file.readAll()).split(___LF, QString::SkipEmptyParts);
+	QStringList curr = provenance(msvc, arch, type).split(___LF, QString::SkipEmptyParts);
+
+	QStringList changed;
+	FOR_CONST_IT(curr)
+		if (!last.contains(*IT))
+			changed.append((*IT).section('=', 0, 0));
+
+	if (!changed.isEmpty())
+	{
+		log("Variant needs to be built:", QString("%1 (%2 changed)").arg(native, changed.join(", ")));
+		return false;
+	}
+
+	log("Variant is up to date:", QString("%1 (same sources, options and toolchain)").arg(native), Elevated);
+	return true;
+}
+
 const QString QtCompile::logFile(const QString &path) const
 {
-	return path+SLASH+QCoreApplication::applicationName()+".log";
+	return path+BuildLog::logFile();
 }
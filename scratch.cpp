@@ -0,0 +1,453 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QRunnable>
+#include "qmath.h"
+
+const QString qtBuilderStaticDrive = "";//Y";	// ... use an existing drive letter (or folder); the ram disk part is skipped when set to anything else but ""; left-over build garbage will not get removed!
+const QString qtBuilderScratchPath("/mnt/qtbuilder");
+#ifdef _WIN32
+const int qtBuilderScratchBackend = ScratchVolume::ImDisk;
+#else
+const int qtBuilderScratchBackend = ScratchVolume::Tmpfs; // ... or ScratchVolume::Zram (needs zramctl and mkfs.ext4)
+#endif
+//
+// the volume starts with the "RamDisk" size; the watcher below grows it in steps while a
+// variant is built as soon as the free space drops under the reserve, and the build loop
+// shrinks it back after each variant. growing stops when the RAM left would get too low.
+//
+const int qtBuilderScratchPollMs	= 2000;
+const int qtBuilderScratchReserveMb	= 1536;	// ... free space below which the volume is grown.
+const int qtBuilderScratchStepGb	= 2;
+const int qtBuilderScratchRamLeftMb	= 2048;	// ... physical memory always left to the compilers.
+
+class ScratchWatcher : public QRunnable
+{
+public:
+	explicit ScratchWatcher(ScratchVolume *volume) : m_volume(volume) {}
+
+	void run()
+	{
+		QMutexLocker l(&m_volume->m_idle);
+		while(!m_volume->m_stop)
+		{
+			uint total, free;
+			if (m_volume->size(total, free) && free < (uint)qtBuilderScratchReserveMb && !m_volume->grow())
+				break; // ... the build will fail with a full disk as it did before; no need to log it over and over.
+
+			m_volume->m_wake.wait(&m_volume->m_idle, qtBuilderScratchPollMs);
+		}
+	}
+
+private:
+	ScratchVolume *m_volume;
+};
+
+class ImDiskVolume : public ScratchVolume
+{
+public:
+	explicit ImDiskVolume(QtCompile *compile) : ScratchVolume(compile), m_unit(imdiskUnit) {}
+
+	const QString name() const { return QString("RAM disk \"%1\"").arg(m_root); }
+	bool attach(int sizeGb);
+	bool detach(bool force);
+	bool resize(int sizeGb);
+	bool shrinkable() const { return false; }
+
+protected:
+	const QString driveLetter();
+
+private:
+	uint m_unit;
+};
+
+class DirectoryVolume : public ScratchVolume
+{
+public:
+	explicit DirectoryVolume(QtCompile *compile, const QString &path) : ScratchVolume(compile), m_path(path) {}
+
+	const QString name() const { return QString("folder \"%1\"").arg(QDir::toNativeSeparators(m_root)); }
+	bool attach(int sizeGb);
+	bool detach(bool force)  { Q_UNUSED(force);  return true; }
+	bool resize(int sizeGb)  { Q_UNUSED(sizeGb); return true; }
+
+private:
+	QString m_path;
+};
+
+class TmpfsVolume : public ScratchVolume
+{
+public:
+	explicit TmpfsVolume(QtCompile *compile) : ScratchVolume(compile) {}
+
+	const QString name() const { return QString("tmpfs \"%1\"").arg(m_root); }
+	bool attach(int sizeGb);
+	bool detach(bool force);
+	bool resize(int sizeGb);
+
+	static bool mounted(const QString &path);
+};
+
+class ZramVolume : public ScratchVolume
+{
+public:
+	explicit ZramVolume(QtCompile *compile) : ScratchVolume(compile) {}
+
+	const QString name() const { return QString("zram \"%1\" (%2)").arg(m_root, m_device); }
+	bool attach(int sizeGb);
+	bool detach(bool force);
+	bool resize(int sizeGb);
+	bool shrinkable() const { return false; }
+
+private:
+	QString m_device;
+};
+
+
+
+ScratchVolume::ScratchVolume(QtCompile *compile) :
+	m_compile(compile), m_keep(false), m_size(0), m_base(0)
+{
+	m_pool.setMaxThreadCount(1);
+}
+
+ScratchVolume::~ScratchVolume()
+{
+	unwatch();
+}
+
+ScratchVolume *ScratchVolume::create(QtCompile *compile)
+{
+	if (!qtBuilderStaticDrive.isEmpty())
+		return new DirectoryVolume(compile, qtBuilderStaticDrive);
+
+	switch(qtBuilderScratchBackend)
+	{
+	case Tmpfs:	return new TmpfsVolume(compile);
+	case Zram:	return new ZramVolume(compile);
+	}
+	return new ImDiskVolume(compile);
+}
+
+bool ScratchVolume::size(uint &totalMb, uint &freeMb) const
+{
+	return getDiskSpace(m_root, totalMb, freeMb);
+}
+
+void ScratchVolume::watch()
+{
+	if (m_keep && m_size <= 0) // ... nothing known about a foreign folder.
+		return;
+
+	m_base = m_size;
+	m_stop = 0;
+	m_pool.start(new ScratchWatcher(this));
+}
+
+void ScratchVolume::unwatch()
+{
+	{	QMutexLocker l(&m_idle);
+		m_stop = 1;
+		m_wake.wakeAll();
+	}
+	m_pool.waitForDone();
+}
+
+bool ScratchVolume::grow()
+{
+	QMutexLocker l(&m_lock);
+
+	uint totalMb, freeMb;
+	if (!getMemorySize(totalMb, freeMb) ||
+		 freeMb < uint(qtBuilderScratchStepGb*1024 + qtBuilderScratchRamLeftMb))
+	{
+		log("Scratch volume nearly full:", QString("%1GB, not enough RAM left to grow").arg(m_size), Warning);
+		return false;
+	}
+
+	int from = m_size;
+	if (!resize(m_size+qtBuilderScratchStepGb))
+		return false;
+
+	log("Scratch volume grown:", QString("%1GB -> %2GB").arg(from).arg(m_size), Warning);
+	return true;
+}
+
+bool ScratchVolume::shrink()
+{
+	QMutexLocker l(&m_lock);
+	if (m_size <= m_base || !shrinkable())
+		return true;
+
+	uint total, free;
+	if (!size(total, free))
+		return false;
+
+	int used = qCeil((total-free)/1024.0);
+	int next = qMax(m_base, used+qtBuilderScratchStepGb);
+	if (next >= m_size)
+		return true;
+
+	int from = m_size;
+	if (!resize(next))
+		return false;
+
+	log("Scratch volume shrunk:", QString("%1GB -> %2GB").arg(from).arg(m_size));
+	return true;
+}
+
+void ScratchVolume::log(const QString &msg, const QString &text, int type)
+{
+	m_compile->log(msg, text, type);
+}
+
+bool ScratchVolume::run(const QString &prog, const QString &args, QString *out, bool silent)
+{
+	InlineProcess p(m_compile, prog, args, silent);
+	if (out)
+		*out = p.stdOut();
+	return p.normalExit();
+}
+
+
+
+bool ImDiskVolume::attach(int sizeGb)
+{
+	QString letter = driveLetter();
+	if (letter.isEmpty())
+	{
+		log("No drive letter available", QString(), Critical);
+		return false;
+	}
+
+	QString out;
+	run("imdisk.exe", "-l -n", &out);
+
+	if (out.contains(QString::number(m_unit)))
+	{
+		QString inf;
+		run("imdisk.exe", QString("-l -u %1").arg(m_unit), &inf);
+		if (inf.contains(imdiskDrive))
+		{
+			letter	= getValueFrom(inf, imdiskDrive, ___LF);
+			m_size	= getValueFrom(inf, imdiskSizeS, " ").toULongLong() /1024 /1024 /1024;
+			m_root	= letter+":";
+			m_keep	= true;
+			log("Using existing RAM disk", QString("Drive letter %1, %2GB").arg(letter).arg(m_size));
+			return m_size >= sizeGb || resize(sizeGb);
+		}
+		else while(out.contains(QString::number(m_unit)))
+		{
+			m_unit++;
+		}
+	}
+
+	log("Trying to attach RAM disk", QString("Drive letter %1, %2GB").arg(letter).arg(sizeGb));
+
+	QString args = QString("-a -m %1: -u %2 -s %3G -o rem -p \"/fs:ntfs /q /y\"");
+	args  = args.arg(letter).arg(m_unit).arg(sizeGb);
+
+	if (!run("imdisk.exe", args, NULL, false))
+		return false;
+
+	m_root = letter+":";
+	m_size = sizeGb;
+	return true;
+}
+
+bool ImDiskVolume::detach(bool force)
+{
+	if (m_keep)
+		return true;
+
+	log("Trying to remove RAM disk");
+
+	QString args = QString("-%1 -u %2");
+	args  = args.arg(force ? "D" : "d").arg(m_unit);
+	return run("imdisk.exe", args, NULL, false);
+}
+
+bool ImDiskVolume::resize(int sizeGb)
+{	//
+	// note: imdisk extends the virtual disk BY the given size (it can't shrink it); the NTFS
+	// volume on it is extended along (imdisk 1.7+)
+	//
+	if (sizeGb == m_size)
+		return true;
+
+	if (sizeGb < m_size)
+	{
+		log("RAM disk can't be shrunk:", QString("%1GB -> %2GB").arg(m_size).arg(sizeGb), Warning);
+		return false;
+	}
+
+	QString args = QString("-e -s %1G -u %2").arg(sizeGb-m_size).arg(m_unit);
+	if (!run("imdisk.exe", args, NULL, false))
+		return false;
+
+	m_size = sizeGb;
+	return true;
+}
+
+const QString ImDiskVolume::driveLetter()
+{
+	QFileInfoList drives = QDir::drives();
+	QStringList aToZ;
+
+	int a = (int)QChar('A').toLatin1();
+	int z = (int)QChar('Z').toLatin1();
+	for(int i = a; i <= z; i++)
+		aToZ.append(QChar::fromLatin1(i));
+
+	FOR_CONST_IT(drives)
+		aToZ.removeOne((*IT).absolutePath().left(1).toUpper());
+	if (aToZ.isEmpty())
+		return QString();
+
+	return aToZ.last();
+}
+
+
+
+bool DirectoryVolume::attach(int sizeGb)
+{
+	Q_UNUSED(sizeGb);
+	m_root = m_path.length() == 1 ? m_path+":" : QDir::cleanPath(m_path); // ... a plain drive letter, as before.
+	m_keep = true;
+
+	if (!QDir(m_root).exists() && !QDir().mkpath(m_root))
+		return false;
+
+	log("Using existing scratch folder", QDir::toNativeSeparators(m_root));
+	return true;
+}
+
+
+
+bool TmpfsVolume::mounted(const QString &path)
+{
+	QFile mounts("/proc/mounts");
+	if (!mounts.open(QIODevice::ReadOnly))
+		return false;
+
+	QStringList lines = QString(mounts.readAll()).split(___LF, QString::SkipEmptyParts);
+	FOR_CONST_IT(lines)
+		if ((*IT).section(' ', 1, 1) == path)
+			return true;
+	return false;
+}
+
+bool TmpfsVolume::attach(int sizeGb)
+{
+	m_root = qtBuilderScratchPath;
+	if (mounted(m_root))
+	{
+		uint total, free;
+		if (size(total, free))
+			m_size = total/1024;
+
+		m_keep = true;
+		log("Using existing tmpfs", QString("%1, %2GB").arg(m_root).arg(m_size));
+		return m_size >= sizeGb || resize(sizeGb);
+	}
+	if (!QDir(m_root).exists() && !QDir().mkpath(m_root))
+		return false;
+
+	log("Trying to mount tmpfs", QString("%1, %2GB").arg(m_root).arg(sizeGb));
+	if (!run("mount", QString("-t tmpfs -o size=%1G,mode=0755 qtbuilder %2").arg(sizeGb).arg(m_root), NULL, false) || !mounted(m_root))
+		return false;
+
+	m_size = sizeGb;
+	return true;
+}
+
+bool TmpfsVolume::detach(bool force)
+{
+	if (m_keep)
+		return true;
+
+	log("Trying to unmount tmpfs");
+	return run("umount", QString("%1%2").arg(force ? "-l " : "", m_root), NULL, false);
+}
+
+bool TmpfsVolume::resize(int sizeGb)
+{	//
+	// tmpfs only allocates what is actually used; the size is just the upper limit; the
+	// remount fails by itself when shrinking below the space in use, nothing is lost then.
+	//
+	if (!run("mount", QString("-o remount,size=%1G %2").arg(sizeGb).arg(m_root)))
+		return false;
+
+	m_size = sizeGb;
+	return true;
+}
+
+
+
+bool ZramVolume::attach(int sizeGb)
+{
+	m_root = qtBuilderScratchPath;
+	if (TmpfsVolume::mounted(m_root))
+	{
+		m_keep = true;
+		log("Using existing zram volume", m_root);
+		return true;
+	}
+	if (!QDir(m_root).exists() && !QDir().mkpath(m_root))
+		return false;
+
+	log("Trying to attach zram volume", QString("%1, %2GB").arg(m_root).arg(sizeGb));
+
+	if (!run("zramctl", QString("--find --size %1G --algorithm lz4").arg(sizeGb), &m_device) ||
+		(m_device = m_device.trimmed()).isEmpty())
+		return false;
+
+	m_size = sizeGb;
+	return run("mkfs.ext4", QString("-q -m 0 -O ^has_journal %1").arg(m_device), NULL, false) &&
+		   run("mount", QString("-o noatime %1 %2").arg(m_device, m_root), NULL, false);
+}
+
+bool ZramVolume::detach(bool force)
+{
+	if (m_keep)
+		return true;
+
+	log("Trying to remove zram volume");
+	return run("umount", QString("%1%2").arg(force ? "-l " : "", m_root), NULL, false) &&
+		   run("zramctl", QString("--reset %1").arg(m_device), NULL, false);
+}
+
+bool ZramVolume::resize(int sizeGb)
+{	//
+	// the zram disk size is fixed once the device is initialized; it is only
+	// compressed RAM actually written to, thus over-sizing it costs nothing.
+	//
+	if (sizeGb <= m_size)
+		return true;
+
+	log("Zram volume can't be resized:", QString("%1GB -> %2GB").arg(m_size).arg(sizeGb), Warning);
+	return false;
+}
@@ -0,0 +1,193 @@
+/*
+	The MIT License (MIT)
+
+	Copyright (c) 2015, Gerald Gstaltner
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+*/
+#include "qtbuilder.h"
+#include "helpers.h"
+
+#include <QRunnable>
+#include <QDateTime>
+#include <QThread>
+//
+// clearing a target tree of several GB used to block the build loop; instead the tree is
+// renamed into the trash folder (same volume, thus instant) and deleted in the background
+// by the pool below, while the build goes on. whatever is left over (i.e. because the app
+// was closed meanwhile) is purged with the next start; only entries named by the trash
+// bin itself are ever touched there!
+//
+// note: the pool is shared by the trash bins of all lanes, so the deleters don't multiply
+// with the lanes (they compete with jom for the same disk).
+//
+const QRegExp qtBuilderTrashName("^trash-\\d{17}-\\d+$");
+
+static QThreadPool *qtBuilderTrashPool()
+{
+	static QThreadPool pool;
+	return &pool;
+}
+
+class TrashJob : public QRunnable
+{
+public:
+	TrashJob(TrashBin *bin, const QFileInfo &entry, const QString &tree, QSharedPointer<QAtomicInt> parts) :
+		m_bin(bin), m_entry(entry), m_tree(tree), m_parts(parts) {}
+
+	void run()
+	{
+		QThread::currentThread()->setPriority(QThread::LowestPriority);
+
+		if (m_entry.isDir()) // ... a link to a folder is just unlinked there.
+			 TrashBin::removeTree(m_entry.absoluteFilePath(), m_bin);
+		else QFile::remove(m_entry.absoluteFilePath());
+
+		if (!m_parts->deref())
+			QDir().rmdir(m_tree);
+
+		m_bin->done();
+	}
+
+private:
+	TrashBin *m_bin;
+	QFileInfo m_entry;
+	QString m_tree;
+	QSharedPointer<QAtomicInt> m_parts;
+};
+
+TrashBin::TrashBin()
+{	// ... all trash bins are created in the gui thread (with their QtCompile, see QtCompile::sync).
+	qtBuilderTrashPool()->setMaxThreadCount(qMax(QThread::idealThreadCount()/2, 1));
+}
+
+TrashBin::~TrashBin()
+{
+	m_cancel = 1;
+	wait();
+}
+
+void TrashBin::setRoot(const QString &root)
+{
+	m_root = QDir::cleanPath(root);
+}
+
+void TrashBin::wait()
+{	//
+	// only the own jobs are waited for; the pool is shared.
+	//
+	QMutexLocker l(&m_lock);
+	while(m_pending.fetchAndAddAcquire(0))
+		m_done.wait(&m_lock);
+}
+
+void TrashBin::done()
+{
+	if (m_pending.deref())
+		return;
+
+	QMutexLocker l(&m_lock);
+	m_done.wakeAll();
+}
+
+bool TrashBin::trash(const QString &path)
+{
+	if (m_root.isEmpty() || (!QDir(m_root).exists() && !QDir().mkpath(m_root)))
+		return false;
+
+	QString name = QString("trash-%1-%2")
+		.arg(QDateTime::currentDateTime().toString("yyyyMMddhhmmsszzz"))
+		.arg(m_serial.fetchAndAddOrdered(1));
+
+	QString tree = m_root+SLASH+name;
+	if (!QDir().rename(path, tree))
+		return false; // ... i.e. not on the same volume; up to the caller to remove it the slow way.
+
+	schedule(tree);
+	return true;
+}
+
+int TrashBin::purge()
+{
+	if (m_root.isEmpty())
+		return 0;
+
+	QStringList trees = QDir(m_root).entryList(QDir::AllDirs|QDir::NoDotAndDotDot|QDir::Hidden|QDir::System);
+	int count = 0;
+	FOR_CONST_IT(trees)
+	{
+		if (!qtBuilderTrashName.exactMatch(*IT))
+			continue;
+
+		schedule(m_root+SLASH+*IT);
+		count++;
+	}
+	return count;
+}
+
+void TrashBin::schedule(const QString &path)
+{	//
+	// one job per top level entry of the trashed tree; the last one removes the tree itself.
+	//
+	if (QFileInfo(path).isSymLink())
+	{
+		removeLink(path); // ... a trashed link (or junction); never what it points to.
+		return;
+	}
+
+	QFileInfoList infos = QDir(path).entryInfoList(QDir::NoDotAndDotDot|QDir::System|QDir::Hidden|QDir::AllDirs|QDir::Files);
+	if (infos.isEmpty())
+	{
+		QDir().rmdir(path);
+		return;
+	}
+
+	QSharedPointer<QAtomicInt> parts(new QAtomicInt(infos.count()));
+	m_pending.fetchAndAddOrdered(infos.count());
+	FOR_CONST_IT(infos)
+		qtBuilderTrashPool()->start(new TrashJob(this, *IT, path, parts));
+}
+
+bool TrashBin::removeTree(const QString &path, const TrashBin *bin)
+{
+	if (QFileInfo(path).isSymLink())
+		return removeLink(path);
+
+	bool result = true;
+	QDir dir(path);
+
+	QFileInfoList infos = dir.entryInfoList(QDir::NoDotAndDotDot|QDir::System|QDir::Hidden|QDir::AllDirs|QDir::Files);
+	FOR_CONST_IT(infos)
+	{
+		if (bin && bin->cancelled())
+			return false;
+
+		if ((*IT).isDir())
+			 result &= removeTree((*IT).absoluteFilePath(), bin);
+		else result &= QFile::remove((*IT).absoluteFilePath());
+	}
+	return result && dir.rmdir(path);
+}
+
+bool TrashBin::removeLink(const QString &path)
+{	//
+	// a link to a folder (and a junction) is removed like a folder on Windows, like a file elsewhere.
+	//
+	return QFile::remove(path) || QDir().rmdir(path);
+}